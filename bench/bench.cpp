@@ -0,0 +1,517 @@
+#include "cxx/vector.hpp"
+#include "cxx/array.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The allocation counters are updated by the replaced global allocation
+// functions below, which every allocator used by the benchmarks ends up in.
+namespace
+{
+
+std::size_t alloc_count = 0;
+std::size_t alloc_bytes = 0;
+
+} // unnamed namespace;
+
+// GCC pairs the inlined malloc and free below with the new and delete
+// expressions of the callers, and warns about the mismatch.
+#if defined(__GNUC__)
+#	define CXX_BENCH_NOINLINE __attribute__((noinline))
+#else
+#	define CXX_BENCH_NOINLINE
+#endif
+
+CXX_BENCH_NOINLINE void*
+operator new(std::size_t n)
+{
+	++alloc_count;
+	alloc_bytes += n;
+	if(void* p = std::malloc(n == 0 ? 1 : n))
+		return p;
+	throw std::bad_alloc();
+}
+
+CXX_BENCH_NOINLINE void*
+operator new[](std::size_t n)
+{
+	return ::operator new(n);
+}
+
+CXX_BENCH_NOINLINE void
+operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+CXX_BENCH_NOINLINE void
+operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+CXX_BENCH_NOINLINE void
+operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+CXX_BENCH_NOINLINE void
+operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace
+{
+
+using std::size_t;
+using std::string;
+
+// 基准测试的框架
+
+struct options
+{
+	size_t max_size = 10000000;
+	//! \brief 每次重复至少运行的秒数
+	double min_time = 0.05;
+	unsigned repetitions = 5;
+	//! \brief 只运行名称包含此字符串的基准测试
+	string filter;
+};
+
+options opts;
+bool first_result = true;
+
+//! \brief 阻止编译器删除计算 x 的代码
+template<typename _type>
+inline void
+keep(const _type& x)
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "r"(&x) : "memory");
+#else
+	static const void* volatile sink;
+
+	sink = &x;
+#endif
+}
+
+struct sample
+{
+	double seconds;
+	size_t allocs;
+	size_t bytes;
+};
+
+template<typename _fBody>
+sample
+measure(_fBody& body, size_t iterations)
+{
+	const size_t allocs = alloc_count, bytes = alloc_bytes;
+	const auto start = std::chrono::steady_clock::now();
+
+	body(iterations);
+
+	const auto stop = std::chrono::steady_clock::now();
+
+	return {std::chrono::duration<double>(stop - start).count(),
+		alloc_count - allocs, alloc_bytes - bytes};
+}
+
+/*!
+\brief 运行一个基准测试并输出一条 JSON 记录
+\param items 每次迭代的操作数， ns/op 等按操作计算
+\note body(k) 执行 k 次迭代。预热阶段同时确定迭代次数，
+	使每次重复至少运行 min_time 秒。
+*/
+template<typename _fBody>
+void
+run(const string& container, const char* element, const char* operation,
+	size_t size, size_t items, _fBody body)
+{
+	const string name
+		= container + '<' + element + ">/" + operation + '/' + std::to_string(size);
+
+	if(name.find(opts.filter) == string::npos)
+		return;
+
+	size_t iterations = 1;
+
+	while(true)
+	{
+		const double t = measure(body, iterations).seconds;
+
+		if(t >= opts.min_time || iterations >= size_t(1) << 40)
+			break;
+		// grow towards the target with some margin, at most 100 times
+		const double scale = t <= opts.min_time / 100 ? 100
+			: opts.min_time * 1.4 / t;
+
+		iterations = std::max(iterations + 1, size_t(double(iterations) * scale));
+	}
+
+	std::vector<sample> samples;
+
+	for(unsigned i = 0; i != opts.repetitions; ++i)
+		samples.push_back(measure(body, iterations));
+
+	std::vector<double> ns;
+	const double ops = double(iterations) * double(items);
+
+	for(const auto& s: samples)
+		ns.push_back(s.seconds * 1e9 / ops);
+	std::sort(ns.begin(), ns.end());
+
+	double mean = 0;
+
+	for(double x: ns)
+		mean += x;
+	mean /= double(ns.size());
+
+	std::printf("%s\n    {\"name\": \"%s\", \"container\": \"%s\", "
+		"\"element\": \"%s\", \"operation\": \"%s\", \"size\": %zu,\n"
+		"     \"iterations\": %zu, \"repetitions\": %zu, "
+		"\"items_per_iteration\": %zu,\n"
+		"     \"ns_per_op\": %.4f, \"ns_per_op_min\": %.4f, "
+		"\"ns_per_op_mean\": %.4f,\n"
+		"     \"bytes_per_op\": %.4f, \"allocs_per_op\": %.6f, "
+		"\"allocs_per_iteration\": %.3f}",
+		first_result ? "" : ",", name.c_str(), container.c_str(), element,
+		operation, size, iterations, ns.size(), items, ns[ns.size() / 2],
+		ns.front(), mean, double(samples.front().bytes) / ops,
+		double(samples.front().allocs) / ops,
+		double(samples.front().allocs) / double(iterations));
+	std::fflush(stdout);
+	first_result = false;
+}
+
+
+// 元素类型：平凡的 int 和不平凡的 std::string （超出短字符串缓冲区，
+// 复制时分配内存）。
+
+template<typename _type>
+struct element;
+
+template<>
+struct element<int>
+{
+	static const char*
+	name()
+	{
+		return "int";
+	}
+	static int
+	value(size_t i)
+	{
+		return int(i);
+	}
+	template<class _tVector>
+	static void
+	emplace(_tVector& v, size_t i)
+	{
+		v.emplace_back(int(i));
+	}
+};
+
+template<>
+struct element<string>
+{
+	static const char*
+	name()
+	{
+		return "string";
+	}
+	static string
+	value(size_t i)
+	{
+		return string(24, char('a' + i % 26));
+	}
+	template<class _tVector>
+	static void
+	emplace(_tVector& v, size_t i)
+	{
+		v.emplace_back(size_t(24), char('a' + i % 26));
+	}
+};
+
+
+namespace vector_bench
+{
+
+template<template<typename...> class _tVector, typename _type>
+void
+run_size(const string& container, size_t n)
+{
+	using vector = _tVector<_type>;
+	using elem = element<_type>;
+	const char* name = elem::name();
+	const _type val = elem::value(0);
+	vector src;
+
+	for(size_t i = 0; i != n; ++i)
+		src.push_back(elem::value(i));
+
+	run(container, name, "push_back", n, n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			vector v;
+
+			for(size_t i = 0; i != n; ++i)
+				v.push_back(val);
+			keep(v);
+		}
+	});
+	run(container, name, "emplace_back", n, n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			vector v;
+
+			for(size_t i = 0; i != n; ++i)
+				elem::emplace(v, i);
+			keep(v);
+		}
+	});
+	run(container, name, "reserve_fill", n, n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			vector v;
+
+			v.reserve(n);
+			for(size_t i = 0; i != n; ++i)
+				v.push_back(val);
+			keep(v);
+		}
+	});
+	run(container, name, "range_insert", n, n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			vector v;
+
+			v.insert(v.end(), src.begin(), src.end());
+			keep(v);
+		}
+	});
+	{
+		// one operation inserts an element in the middle and erases it again
+		vector v(src);
+
+		run(container, name, "middle_insert_erase", n, 1, [&](size_t k) {
+			while(k-- != 0)
+			{
+				v.insert(v.begin() + std::ptrdiff_t(n / 2), val);
+				v.erase(v.begin() + std::ptrdiff_t(n / 2));
+				keep(v);
+			}
+		});
+	}
+	{
+		// the destination keeps its storage, so only the elements are copied
+		vector v;
+
+		run(container, name, "copy_assign", n, n, [&](size_t k) {
+			while(k-- != 0)
+			{
+				v = src;
+				keep(v);
+			}
+		});
+	}
+	{
+		// one operation is one move assignment
+		vector a(src), b;
+
+		run(container, name, "move_assign", n, 2, [&](size_t k) {
+			while(k-- != 0)
+			{
+				b = std::move(a);
+				a = std::move(b);
+				keep(a);
+			}
+		});
+	}
+	run(container, name, "resize", n, n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			vector v;
+
+			v.resize(n);
+			keep(v);
+		}
+	});
+}
+
+template<typename... _types>
+using std_vector = std::vector<_types...>;
+template<typename... _types>
+using cxx_vector = cxx::vector<_types...>;
+
+const size_t sizes[]{8, 64, 512, 4096, 32768, 262144, 2097152, 10000000};
+
+template<typename _type>
+void
+run_type()
+{
+	for(size_t n: sizes)
+		if(n <= opts.max_size)
+		{
+			run_size<cxx_vector, _type>("cxx::vector", n);
+			run_size<std_vector, _type>("std::vector", n);
+		}
+}
+
+void
+run()
+{
+	run_type<int>();
+	run_type<string>();
+}
+
+} // namespace vector_bench;
+
+namespace array_bench
+{
+
+// 数组的大小是模板参数，只测试不需要改变大小的操作。
+template<class _tArray, typename _type, size_t _vN>
+void
+run_array(const string& container)
+{
+	using elem = element<_type>;
+	const char* name = elem::name();
+	const size_t n = _vN;
+	const _type val = elem::value(1);
+	// large arrays do not fit on the stack
+	std::unique_ptr<_tArray> src(new _tArray()), dst(new _tArray());
+
+	for(size_t i = 0; i != n; ++i)
+		(*src)[i] = elem::value(i);
+
+	run(container, name, "copy_assign", n, n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			*dst = *src;
+			keep(*dst);
+		}
+	});
+	run(container, name, "move_assign", n, 2 * n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			*dst = std::move(*src);
+			*src = std::move(*dst);
+			keep(*src);
+		}
+	});
+	run(container, name, "fill", n, n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			dst->fill(val);
+			keep(*dst);
+		}
+	});
+	run(container, name, "swap", n, n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			dst->swap(*src);
+			keep(*dst);
+		}
+	});
+}
+
+template<typename _type, size_t _vN>
+void
+run_size()
+{
+	if(_vN <= opts.max_size)
+	{
+		run_array<cxx::array<_type, _vN>, _type, _vN>("cxx::array");
+		run_array<std::array<_type, _vN>, _type, _vN>("std::array");
+	}
+}
+
+template<typename _type>
+void
+run_type()
+{
+	run_size<_type, 8>();
+	run_size<_type, 64>();
+	run_size<_type, 512>();
+	run_size<_type, 4096>();
+	run_size<_type, 32768>();
+}
+
+void
+run()
+{
+	run_type<int>();
+	run_type<string>();
+}
+
+} // namespace array_bench;
+
+void
+usage(const char* prog)
+{
+	std::fprintf(stderr,
+		"usage: %s [--max-size=N] [--min-time=SECONDS] [--repetitions=N] "
+		"[--filter=SUBSTRING]\n",
+		prog);
+	std::exit(2);
+}
+
+void
+parse_options(int argc, char* argv[])
+{
+	for(int i = 1; i != argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* eq = std::strchr(arg, '=');
+
+		if(!eq)
+			usage(argv[0]);
+
+		const string key(arg, eq);
+		const char* value = eq + 1;
+
+		if(key == "--max-size")
+			opts.max_size = std::strtoull(value, {}, 10);
+		else if(key == "--min-time")
+			opts.min_time = std::strtod(value, {});
+		else if(key == "--repetitions")
+			opts.repetitions = unsigned(std::strtoul(value, {}, 10));
+		else if(key == "--filter")
+			opts.filter = value;
+		else
+			usage(argv[0]);
+	}
+	if(opts.repetitions == 0)
+		opts.repetitions = 1;
+}
+
+} // unnamed namespace;
+
+int
+main(int argc, char* argv[])
+{
+	parse_options(argc, argv);
+
+	char date[32];
+	const std::time_t now = std::time({});
+
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+	std::printf("{\n  \"context\": {\"date\": \"%s\", \"max_size\": %zu, "
+		"\"min_time\": %g, \"repetitions\": %u},\n  \"benchmarks\": [",
+		date, opts.max_size, opts.min_time, opts.repetitions);
+	vector_bench::run();
+	array_bench::run();
+	std::printf("\n  ]\n}\n");
+}
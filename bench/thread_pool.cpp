@@ -0,0 +1,293 @@
+#include "cxx/thread_pool.hpp"
+#include "cxx/parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using std::size_t;
+using std::string;
+using cxx::thread_pool;
+namespace parallel = cxx::parallel;
+
+// 线程池的扩展性基准测试：每个负载在 1 、 2 、 4 …… 个工作线程上运行，
+// 加速比相对于 1 个线程的结果。负载在线程池的任务中启动，只有工作线程参与计算。
+
+struct options
+{
+	//! \brief 最多的工作线程数，为 0 时取硬件线程数
+	unsigned max_threads = 0;
+	//! \brief 每次重复至少运行的秒数
+	double min_time = 0.1;
+	unsigned repetitions = 5;
+	//! \brief 把工作线程绑定到 CPU
+	bool pin = false;
+	//! \brief 只运行名称包含此字符串的基准测试
+	string filter;
+};
+
+options opts;
+bool first_result = true;
+
+template<typename _type>
+inline void
+keep(const _type& x)
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "r"(&x) : "memory");
+#else
+	static const void* volatile sink;
+
+	sink = &x;
+#endif
+}
+
+template<typename _fBody>
+double
+measure(_fBody& body, size_t iterations)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	body(iterations);
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+//! \brief 每个负载在 1 个线程上的 ns/op ，用于计算加速比
+std::vector<std::pair<string, double>> baselines;
+
+/*!
+\brief 运行一个基准测试并输出一条 JSON 记录
+\param items 每次迭代的操作数
+\note body(k) 执行 k 次迭代，迭代次数在预热时确定，参见 bench.cpp 。
+*/
+template<typename _fBody>
+void
+run(const char* workload, size_t size, unsigned threads, size_t items,
+	_fBody body)
+{
+	const string name = string(workload) + '/' + std::to_string(size);
+
+	if((name + '/' + std::to_string(threads)).find(opts.filter)
+		== string::npos)
+		return;
+
+	size_t iterations = 1;
+
+	while(true)
+	{
+		const double t = measure(body, iterations);
+
+		if(t >= opts.min_time || iterations >= size_t(1) << 40)
+			break;
+
+		const double scale = t <= opts.min_time / 100 ? 100
+			: opts.min_time * 1.4 / t;
+
+		iterations = std::max(iterations + 1, size_t(double(iterations) * scale));
+	}
+
+	std::vector<double> ns;
+	const double ops = double(iterations) * double(items);
+
+	for(unsigned i = 0; i != opts.repetitions; ++i)
+		ns.push_back(measure(body, iterations) * 1e9 / ops);
+	std::sort(ns.begin(), ns.end());
+
+	const double median = ns[ns.size() / 2];
+	double base = 0;
+
+	for(const auto& b: baselines)
+		if(b.first == name)
+			base = b.second;
+	if(base == 0)
+	{
+		base = median;
+		baselines.emplace_back(name, median);
+	}
+	std::printf("%s\n    {\"name\": \"%s/%u\", \"workload\": \"%s\", "
+		"\"size\": %zu, \"threads\": %u,\n"
+		"     \"iterations\": %zu, \"items_per_iteration\": %zu, "
+		"\"ns_per_op\": %.4f, \"ns_per_op_min\": %.4f,\n"
+		"     \"ops_per_second\": %.1f, \"speedup\": %.3f, "
+		"\"efficiency\": %.3f}",
+		first_result ? "" : ",", name.c_str(), threads, workload, size,
+		threads, iterations, items, median, ns.front(), 1e9 / median,
+		base / median, base / median / threads);
+	std::fflush(stdout);
+	first_result = false;
+}
+
+long
+fib(thread_pool& pool, int n, int cutoff)
+{
+	if(n < cutoff)
+		return n < 2 ? n : fib(pool, n - 1, cutoff) + fib(pool, n - 2, cutoff);
+
+	long x = 0, y = 0;
+
+	pool.parallel_invoke([&] { x = fib(pool, n - 1, cutoff); },
+		[&] { y = fib(pool, n - 2, cutoff); });
+	return x + y;
+}
+
+void
+run_threads(unsigned threads)
+{
+	thread_pool pool(threads, opts.pin);
+	parallel::options par;
+
+	par.threads = threads;
+	par.pool = &pool;
+
+	// tiny tasks submitted from outside the pool go through the injection
+	// queue; from inside a worker they are pushed to its own deque
+	const size_t tasks = 10000;
+	std::atomic<size_t> counter{0};
+	std::vector<std::future<void>> futures;
+
+	futures.reserve(tasks);
+	run("submit_external", tasks, threads, tasks, [&](size_t k) {
+		while(k-- != 0)
+		{
+			futures.clear();
+			for(size_t i = 0; i != tasks; ++i)
+				futures.push_back(pool.submit([&] {
+					counter.fetch_add(1, std::memory_order_relaxed);
+				}));
+			for(auto& f: futures)
+				f.get();
+		}
+	});
+	run("submit_internal", tasks, threads, tasks, [&](size_t k) {
+		while(k-- != 0)
+			pool.submit([&] {
+				futures.clear();
+				for(size_t i = 0; i != tasks; ++i)
+					futures.push_back(pool.submit([&] {
+						counter.fetch_add(1, std::memory_order_relaxed);
+					}));
+				for(auto& f: futures)
+					pool.wait(f);
+			}).get();
+	});
+	// fork-join with tasks of a few microseconds
+	run("fib", 30, threads, 1, [&](size_t k) {
+		while(k-- != 0)
+		{
+			const long r = pool.submit([&] { return fib(pool, 30, 16); }).get();
+
+			keep(r);
+		}
+	});
+
+	const size_t n = size_t(1) << 22;
+	std::vector<int> src(n);
+	unsigned x = 1;
+
+	for(auto& i: src)
+		i = int((x = x * 1103515245U + 12345U) >> 8);
+	run("reduce", n, threads, n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			const long r = pool.submit([&] {
+				return parallel::transform_reduce(par, src.begin(), src.end(),
+					0L, std::plus<>(), [](int i) { return long(i); });
+			}).get();
+
+			keep(r);
+		}
+	});
+
+	std::vector<int> v(n);
+
+	// each iteration copies the unsorted input first
+	run("sort", n, threads, n, [&](size_t k) {
+		while(k-- != 0)
+		{
+			pool.submit([&] {
+				parallel::transform(par, src.begin(), src.end(), v.begin(),
+					[](int i) { return i; });
+				parallel::sort(par, v.begin(), v.end());
+			}).get();
+			keep(v);
+		}
+	});
+}
+
+void
+usage(const char* prog)
+{
+	std::fprintf(stderr,
+		"usage: %s [--max-threads=N] [--min-time=SECONDS] [--repetitions=N] "
+		"[--pin=0|1] [--filter=SUBSTRING]\n",
+		prog);
+	std::exit(2);
+}
+
+void
+parse_options(int argc, char* argv[])
+{
+	for(int i = 1; i != argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* eq = std::strchr(arg, '=');
+
+		if(!eq)
+			usage(argv[0]);
+
+		const string key(arg, eq);
+		const char* value = eq + 1;
+
+		if(key == "--max-threads")
+			opts.max_threads = unsigned(std::strtoul(value, {}, 10));
+		else if(key == "--min-time")
+			opts.min_time = std::strtod(value, {});
+		else if(key == "--repetitions")
+			opts.repetitions = unsigned(std::strtoul(value, {}, 10));
+		else if(key == "--pin")
+			opts.pin = std::strtoul(value, {}, 10) != 0;
+		else if(key == "--filter")
+			opts.filter = value;
+		else
+			usage(argv[0]);
+	}
+	if(opts.max_threads == 0)
+		opts.max_threads = std::max(std::thread::hardware_concurrency(), 1U);
+	if(opts.repetitions == 0)
+		opts.repetitions = 1;
+}
+
+} // unnamed namespace;
+
+int
+main(int argc, char* argv[])
+{
+	parse_options(argc, argv);
+
+	char date[32];
+	const std::time_t now = std::time({});
+
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+	std::printf("{\n  \"context\": {\"date\": \"%s\", \"hardware_threads\": %u, "
+		"\"max_threads\": %u, \"min_time\": %g, \"repetitions\": %u, "
+		"\"pin\": %s},\n  \"benchmarks\": [",
+		date, std::thread::hardware_concurrency(), opts.max_threads,
+		opts.min_time, opts.repetitions, opts.pin ? "true" : "false");
+	for(unsigned t = 1;; t *= 2)
+	{
+		run_threads(std::min(t, opts.max_threads));
+		if(t >= opts.max_threads)
+			break;
+	}
+	std::printf("\n  ]\n}\n");
+}
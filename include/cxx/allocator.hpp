@@ -0,0 +1,350 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <cassert>
+#include "meta.hpp"
+
+namespace cxx
+{
+
+/*!
+\brief 单调增长的内存区域
+\note 分配只移动指针；单个释放只在释放最近一次分配时回收空间，
+	其它空间在 release 或析构时一次性归还。
+\note 可以使用调用者提供的初始缓冲区，用尽后从全局 operator new 分配块。
+\note 不可复制，不是线程安全的。
+*/
+class monotonic_arena
+{
+private:
+	struct chunk
+	{
+		chunk* next;
+		size_t size;
+	};
+
+	unsigned char* initial_buffer = {};
+	size_t initial_size = 0;
+	size_t next_chunk_size;
+	chunk* chunks = {};
+	unsigned char* current = {};
+	unsigned char* limit = {};
+
+public:
+	explicit monotonic_arena(size_t chunk_size = 4096) noexcept
+		: next_chunk_size(chunk_size < sizeof(chunk) * 2 ? sizeof(chunk) * 2
+														 : chunk_size)
+	{}
+	monotonic_arena(
+		void* buffer, size_t size, size_t chunk_size = 4096) noexcept
+		: initial_buffer(static_cast<unsigned char*>(buffer)),
+		  initial_size(size), next_chunk_size(chunk_size < sizeof(chunk) * 2
+				  ? sizeof(chunk) * 2
+				  : chunk_size),
+		  current(initial_buffer), limit(initial_buffer + size)
+	{}
+	monotonic_arena(const monotonic_arena&) = delete;
+	~monotonic_arena()
+	{
+		release();
+	}
+
+	monotonic_arena&
+	operator=(const monotonic_arena&)
+		= delete;
+
+	void*
+	allocate(size_t bytes, size_t align = alignof(std::max_align_t))
+	{
+		if(void* p = try_allocate(bytes, align))
+			return p;
+		add_chunk(bytes, align);
+		return try_allocate(bytes, align);
+	}
+	void
+	deallocate(void* p, size_t bytes, size_t = 0) noexcept
+	{
+		const auto q(static_cast<unsigned char*>(p));
+
+		if(q + bytes == current)
+			current = q;
+	}
+	//! \brief 归还所有分配的块，回到只有初始缓冲区的状态
+	void
+	release() noexcept
+	{
+		while(chunks)
+		{
+			const auto next(chunks->next);
+
+			::operator delete(chunks);
+			chunks = next;
+		}
+		current = initial_buffer;
+		limit = initial_buffer + initial_size;
+	}
+
+private:
+	void*
+	try_allocate(size_t bytes, size_t align) noexcept
+	{
+		assert(align != 0 && (align & (align - 1)) == 0);
+
+		const auto addr(reinterpret_cast<std::uintptr_t>(current));
+		const auto padding((align - addr % align) % align);
+
+		if(current && padding <= size_t(limit - current)
+			&& bytes <= size_t(limit - current) - padding)
+		{
+			const auto p(current + padding);
+
+			current = p + bytes;
+			return p;
+		}
+		return {};
+	}
+	void
+	add_chunk(size_t bytes, size_t align)
+	{
+		if(bytes > size_t(-1) - sizeof(chunk) - align)
+			throw std::bad_alloc();
+
+		size_t size(next_chunk_size);
+
+		if(size < sizeof(chunk) + bytes + align)
+			size = sizeof(chunk) + bytes + align;
+
+		const auto p(static_cast<chunk*>(::operator new(size)));
+
+		p->next = chunks;
+		p->size = size;
+		chunks = p;
+		current = reinterpret_cast<unsigned char*>(p) + sizeof(chunk);
+		limit = reinterpret_cast<unsigned char*>(p) + size;
+		if(next_chunk_size <= size_t(-1) / 2)
+			next_chunk_size *= 2;
+	}
+};
+
+
+/*!
+\brief 固定大小块的内存池
+\note 不超过 block_size 字节的请求从空闲链表中取得块，
+	较大的请求直接转发到全局 operator new 。
+\note 对齐要求超过 alignof(std::max_align_t) 的请求也转发到全局 operator new ，
+	多分配 align 字节后手动对齐，原地址保存在返回的地址之前。
+\note 块按 chunk_blocks 个一组批量分配，在析构或 release 时整体归还。
+\note 不可复制，不是线程安全的。
+*/
+class pool_resource
+{
+private:
+	union block
+	{
+		block* next;
+		std::max_align_t align;
+	};
+	struct chunk
+	{
+		chunk* next;
+	};
+
+	size_t block_size;
+	size_t chunk_blocks;
+	block* free_list = {};
+	chunk* chunks = {};
+
+public:
+	explicit pool_resource(size_t bsize, size_t n = 64) noexcept
+		: block_size(((bsize < sizeof(block) ? sizeof(block) : bsize)
+						 + (sizeof(block) - 1))
+			  & ~(sizeof(block) - 1)),
+		  chunk_blocks(n == 0 ? 1 : n)
+	{}
+	pool_resource(const pool_resource&) = delete;
+	~pool_resource()
+	{
+		release();
+	}
+
+	pool_resource&
+	operator=(const pool_resource&)
+		= delete;
+
+	size_t
+	get_block_size() const noexcept
+	{
+		return block_size;
+	}
+
+	void*
+	allocate(size_t bytes, size_t align = alignof(std::max_align_t))
+	{
+		if(align > alignof(block))
+			return allocate_aligned(bytes, align);
+		if(bytes > block_size)
+			return ::operator new(bytes);
+		if(!free_list)
+			add_chunk();
+
+		const auto p(free_list);
+
+		free_list = p->next;
+		return p;
+	}
+	void
+	deallocate(void* p, size_t bytes,
+		size_t align = alignof(std::max_align_t)) noexcept
+	{
+		if(align > alignof(block))
+			deallocate_aligned(p);
+		else if(bytes > block_size)
+			::operator delete(p);
+		else
+		{
+			const auto b(static_cast<block*>(p));
+
+			b->next = free_list;
+			free_list = b;
+		}
+	}
+	//! \brief 归还所有块，之前分配的块全部失效
+	void
+	release() noexcept
+	{
+		while(chunks)
+		{
+			const auto next(chunks->next);
+
+			::operator delete(chunks);
+			chunks = next;
+		}
+		free_list = {};
+	}
+
+private:
+	static void*
+	allocate_aligned(size_t bytes, size_t align)
+	{
+		assert((align & (align - 1)) == 0);
+		if(bytes > size_t(-1) - align)
+			throw std::bad_alloc();
+
+		// at least alignof(block) bytes before the result, enough for the
+		// original address
+		const auto raw(::operator new(bytes + align));
+		const auto addr(reinterpret_cast<std::uintptr_t>(raw));
+		const auto p(reinterpret_cast<void**>((addr + align) & ~(align - 1)));
+
+		p[-1] = raw;
+		return p;
+	}
+	static void
+	deallocate_aligned(void* p) noexcept
+	{
+		::operator delete(static_cast<void**>(p)[-1]);
+	}
+
+	void
+	add_chunk()
+	{
+		const auto p(static_cast<unsigned char*>(
+			::operator new(sizeof(block) + block_size * chunk_blocks)));
+		const auto c(reinterpret_cast<chunk*>(p));
+
+		c->next = chunks;
+		chunks = c;
+		for(size_t i(chunk_blocks); i != 0; --i)
+		{
+			const auto b(reinterpret_cast<block*>(
+				p + sizeof(block) + block_size * (i - 1)));
+
+			b->next = free_list;
+			free_list = b;
+		}
+	}
+};
+
+
+namespace details
+{
+
+/*!
+\brief 引用内存资源的有状态分配器
+\note 复制、移动和交换容器时分配器不传播，容器保持使用原来的资源；
+	引用同一资源的分配器相等。
+*/
+template<typename _type, class _tResource>
+class resource_allocator
+{
+	template<typename, class>
+	friend class resource_allocator;
+
+public:
+	using value_type = _type;
+	using propagate_on_container_copy_assignment = false_;
+	using propagate_on_container_move_assignment = false_;
+	using propagate_on_container_swap = false_;
+	using is_always_equal = false_;
+
+private:
+	_tResource* resource;
+
+public:
+	resource_allocator(_tResource& r) noexcept : resource(std::addressof(r))
+	{}
+	template<typename _tOther>
+	resource_allocator(
+		const resource_allocator<_tOther, _tResource>& a) noexcept
+		: resource(a.resource)
+	{}
+
+	_type*
+	allocate(size_t n)
+	{
+		if(n > size_t(-1) / sizeof(_type))
+			throw std::bad_array_new_length();
+		return static_cast<_type*>(
+			resource->allocate(n * sizeof(_type), alignof(_type)));
+	}
+	void
+	deallocate(_type* p, size_t n) noexcept
+	{
+		resource->deallocate(p, n * sizeof(_type), alignof(_type));
+	}
+
+	_tResource&
+	get_resource() const noexcept
+	{
+		return *resource;
+	}
+
+	template<typename _tOther>
+	friend bool
+	operator==(const resource_allocator& x,
+		const resource_allocator<_tOther, _tResource>& y) noexcept
+	{
+		return x.resource == std::addressof(y.get_resource());
+	}
+	template<typename _tOther>
+	friend bool
+	operator!=(const resource_allocator& x,
+		const resource_allocator<_tOther, _tResource>& y) noexcept
+	{
+		return !(x == y);
+	}
+};
+
+} // namespace details;
+
+//! \brief 从 monotonic_arena 分配的分配器
+template<typename _type>
+using arena_allocator = details::resource_allocator<_type, monotonic_arena>;
+
+//! \brief 从 pool_resource 分配的分配器
+template<typename _type>
+using pool_allocator = details::resource_allocator<_type, pool_resource>;
+
+}
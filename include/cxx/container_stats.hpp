@@ -0,0 +1,379 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "meta.hpp"
+
+namespace cxx
+{
+
+//! \brief 某一时刻的统计计数
+struct stats_snapshot
+{
+	// 分配器的事件：
+	size_t allocations;
+	size_t deallocations;
+	size_t bytes_allocated;
+	size_t bytes_deallocated;
+	//! \brief 同时分配的最大字节数
+	size_t peak_live_bytes;
+
+	// 容器的事件：
+	//! \brief 显式调用 reserve 的次数
+	size_t reserve_calls;
+	//! \brief 显式 reserve 时容量已经足够的次数
+	size_t redundant_reserves;
+	//! \brief 重新分配存储以增长容量的次数
+	size_t growths;
+	//! \brief 增长、插入和擦除时移动的元素数和字节数
+	size_t elements_moved;
+	size_t bytes_copied;
+	size_t peak_capacity;
+	//! \brief 释放的存储数、释放时的元素总数和最大元素数
+	size_t releases;
+	size_t released_elements;
+	size_t max_released_size;
+	//! \brief 释放时未使用的容量的总元素数和总字节数
+	size_t slack_elements;
+	size_t slack_bytes;
+};
+
+/*!
+\brief 容器和分配器的统计记录
+\note 计数是原子的，可以由多个线程的容器同时更新。
+\note 容器的事件通过 container_hook 报告，参见 meta.hpp 。
+*/
+class container_stats
+{
+private:
+	using counter = std::atomic<size_t>;
+
+	counter allocations{0};
+	counter deallocations{0};
+	counter bytes_allocated{0};
+	counter bytes_deallocated{0};
+	counter live_bytes{0};
+	counter peak_live_bytes{0};
+	counter reserve_calls{0};
+	counter redundant_reserves{0};
+	counter growths{0};
+	counter elements_moved{0};
+	counter bytes_copied{0};
+	counter peak_capacity{0};
+	counter releases{0};
+	counter released_elements{0};
+	counter max_released_size{0};
+	counter slack_elements{0};
+	counter slack_bytes{0};
+
+	static void
+	add(counter& c, size_t n) noexcept
+	{
+		c.fetch_add(n, std::memory_order_relaxed);
+	}
+	static void
+	raise(counter& c, size_t n) noexcept
+	{
+		size_t old(c.load(std::memory_order_relaxed));
+
+		while(old < n
+			&& !c.compare_exchange_weak(old, n, std::memory_order_relaxed))
+			;
+	}
+
+public:
+	container_stats() = default;
+	container_stats(const container_stats&) = delete;
+
+	container_stats&
+	operator=(const container_stats&)
+		= delete;
+
+	void
+	allocate(size_t bytes) noexcept
+	{
+		add(allocations, 1);
+		add(bytes_allocated, bytes);
+		raise(peak_live_bytes,
+			live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+	}
+	void
+	deallocate(size_t bytes) noexcept
+	{
+		add(deallocations, 1);
+		add(bytes_deallocated, bytes);
+		live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+	}
+	void
+	reserve_call(size_t n, size_t cap) noexcept
+	{
+		add(reserve_calls, 1);
+		if(n <= cap)
+			add(redundant_reserves, 1);
+	}
+	void
+	grow(size_t, size_t new_cap, size_t moved, size_t obj_size) noexcept
+	{
+		add(growths, 1);
+		shift(moved, obj_size);
+		raise(peak_capacity, new_cap);
+	}
+	void
+	shift(size_t moved, size_t obj_size) noexcept
+	{
+		add(elements_moved, moved);
+		add(bytes_copied, moved * obj_size);
+	}
+	void
+	release(size_t n, size_t cap, size_t obj_size) noexcept
+	{
+		add(releases, 1);
+		add(released_elements, n);
+		raise(max_released_size, n);
+		raise(peak_capacity, cap);
+		add(slack_elements, cap - n);
+		add(slack_bytes, (cap - n) * obj_size);
+	}
+
+	stats_snapshot
+	snapshot() const noexcept
+	{
+		const auto get([](const counter& c) noexcept {
+			return c.load(std::memory_order_relaxed);
+		});
+
+		return {get(allocations), get(deallocations), get(bytes_allocated),
+			get(bytes_deallocated), get(peak_live_bytes), get(reserve_calls),
+			get(redundant_reserves), get(growths), get(elements_moved),
+			get(bytes_copied), get(peak_capacity), get(releases),
+			get(released_elements), get(max_released_size),
+			get(slack_elements), get(slack_bytes)};
+	}
+	//! \brief 清零所有计数，分配中的字节数除外
+	void
+	reset() noexcept
+	{
+		for(counter* c : {&allocations, &deallocations, &bytes_allocated,
+				&bytes_deallocated, &reserve_calls, &redundant_reserves,
+				&growths, &elements_moved, &bytes_copied, &peak_capacity,
+				&releases, &released_elements, &max_released_size,
+				&slack_elements, &slack_bytes})
+			c->store(0, std::memory_order_relaxed);
+		peak_live_bytes.store(live_bytes.load(std::memory_order_relaxed),
+			std::memory_order_relaxed);
+	}
+};
+
+/*!
+\brief 按名称保存的统计记录
+\note 名称可以是标签或调用位置，参见 CXX_STATS_SITE 。
+	记录在首次使用时创建，之后地址不变，直到程序结束。
+\note 是线程安全的。
+*/
+class stats_registry
+{
+private:
+	mutable std::mutex mtx;
+	std::map<std::string, std::unique_ptr<container_stats>> records;
+
+public:
+	stats_registry() = default;
+	stats_registry(const stats_registry&) = delete;
+
+	stats_registry&
+	operator=(const stats_registry&)
+		= delete;
+
+	//! \brief 全局的注册表
+	static stats_registry&
+	instance()
+	{
+		static stats_registry registry;
+
+		return registry;
+	}
+
+	container_stats&
+	get(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lck(mtx);
+		auto& p(records[name]);
+
+		if(!p)
+			p.reset(new container_stats());
+		return *p;
+	}
+
+	//! \brief 按名称排序的所有记录
+	std::vector<std::pair<std::string, stats_snapshot>>
+	snapshot() const
+	{
+		std::lock_guard<std::mutex> lck(mtx);
+		std::vector<std::pair<std::string, stats_snapshot>> res;
+
+		for(const auto& r : records)
+			res.emplace_back(r.first, r.second->snapshot());
+		return res;
+	}
+
+	void
+	reset() noexcept
+	{
+		std::lock_guard<std::mutex> lck(mtx);
+
+		for(const auto& r : records)
+			r.second->reset();
+	}
+
+	//! \brief 以名称为键输出所有记录的 JSON 对象
+	void
+	write_json(std::ostream& os) const
+	{
+		const auto list(snapshot());
+
+		os << '{';
+		for(size_t i(0); i != list.size(); ++i)
+		{
+			const stats_snapshot& s(list[i].second);
+
+			os << (i == 0 ? "\n  \"" : ",\n  \"");
+			for(char c : list[i].first)
+			{
+				if(c == '"' || c == '\\')
+					os << '\\';
+				os << c;
+			}
+			os << "\": {\"allocations\": " << s.allocations
+			   << ", \"deallocations\": " << s.deallocations
+			   << ", \"bytes_allocated\": " << s.bytes_allocated
+			   << ", \"bytes_deallocated\": " << s.bytes_deallocated
+			   << ", \"peak_live_bytes\": " << s.peak_live_bytes
+			   << ", \"reserve_calls\": " << s.reserve_calls
+			   << ", \"redundant_reserves\": " << s.redundant_reserves
+			   << ", \"growths\": " << s.growths
+			   << ", \"elements_moved\": " << s.elements_moved
+			   << ", \"bytes_copied\": " << s.bytes_copied
+			   << ", \"peak_capacity\": " << s.peak_capacity
+			   << ", \"releases\": " << s.releases
+			   << ", \"released_elements\": " << s.released_elements
+			   << ", \"max_released_size\": " << s.max_released_size
+			   << ", \"slack_elements\": " << s.slack_elements
+			   << ", \"slack_bytes\": " << s.slack_bytes << '}';
+		}
+		os << (list.empty() ? "}" : "\n}");
+	}
+};
+
+#define CXX_STATS_STRINGIZE_(_x) #_x
+#define CXX_STATS_STRINGIZE(_x) CXX_STATS_STRINGIZE_(_x)
+
+/*!
+\brief 当前调用位置（文件名和行号）的统计记录
+\note 每个位置只在第一次求值时查找注册表。
+*/
+#define CXX_STATS_SITE \
+	([]() -> ::cxx::container_stats& { \
+		static ::cxx::container_stats& site(::cxx::stats_registry::instance() \
+				.get(__FILE__ ":" CXX_STATS_STRINGIZE(__LINE__))); \
+\
+		return site; \
+	}())
+
+/*!
+\brief 记录分配和容器事件的分配器
+\note 包装分配器 _tAlloc ，分配和释放都记录到构造时指定的 container_stats ；
+	默认构造时使用注册表中名称为空的记录。
+\note 提供 get_stats() ，容器通过 container_hook 报告增长等事件；
+	没有 construct 和 destroy ，不影响容器按字节移动元素的优化。
+\note 相等性和 is_always_equal 与 _tAlloc 相同；移动赋值和交换时传播，
+	复制赋值时不传播，使记录跟随存储。
+*/
+template<typename _type, class _tAlloc = std::allocator<_type>>
+class instrumented_allocator : private rebind_alloc_t<_tAlloc, _type>
+{
+	template<typename, class>
+	friend class instrumented_allocator;
+
+private:
+	using base = rebind_alloc_t<_tAlloc, _type>;
+	using base_traits = allocator_traits<base>;
+
+public:
+	using value_type = _type;
+	using propagate_on_container_copy_assignment = false_;
+	using propagate_on_container_move_assignment = true_;
+	using propagate_on_container_swap = true_;
+	using is_always_equal = typename base_traits::is_always_equal;
+
+	template<typename _tOther>
+	struct rebind
+	{
+		using other = instrumented_allocator<_tOther, _tAlloc>;
+	};
+
+private:
+	container_stats* stats;
+
+public:
+	instrumented_allocator()
+		: base(), stats(&stats_registry::instance().get({}))
+	{}
+	explicit instrumented_allocator(
+		container_stats& s, const _tAlloc& a = _tAlloc()) noexcept
+		: base(a), stats(std::addressof(s))
+	{}
+	template<typename _tOther>
+	instrumented_allocator(
+		const instrumented_allocator<_tOther, _tAlloc>& a) noexcept
+		: base(a.get_base()), stats(a.stats)
+	{}
+
+	_type*
+	allocate(size_t n)
+	{
+		const auto p(base_traits::allocate(*this, n));
+
+		stats->allocate(n * sizeof(_type));
+		return p;
+	}
+	void
+	deallocate(_type* p, size_t n) noexcept
+	{
+		stats->deallocate(n * sizeof(_type));
+		base_traits::deallocate(*this, p, n);
+	}
+
+	container_stats&
+	get_stats() const noexcept
+	{
+		return *stats;
+	}
+	const base&
+	get_base() const noexcept
+	{
+		return *this;
+	}
+
+	template<typename _tOther>
+	friend bool
+	operator==(const instrumented_allocator& x,
+		const instrumented_allocator<_tOther, _tAlloc>& y) noexcept
+	{
+		return x.get_base() == base(y.get_base());
+	}
+	template<typename _tOther>
+	friend bool
+	operator!=(const instrumented_allocator& x,
+		const instrumented_allocator<_tOther, _tAlloc>& y) noexcept
+	{
+		return !(x == y);
+	}
+};
+
+}
@@ -0,0 +1,696 @@
+#pragma once
+
+#include "flat_set.hpp"
+
+namespace cxx
+{
+
+namespace details
+{
+
+/*!
+\brief 同时遍历键和值两个序列的迭代器
+\note 解引用得到 std::pair<const _tKey&, _tRef> 代理对象。
+*/
+template<typename _tKey, typename _tRef, typename _tKeyIt, typename _tValIt>
+class flat_map_iterator
+{
+	template<typename, typename, typename, typename>
+	friend class flat_map_iterator;
+
+public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = std::pair<const _tKey,
+		typename std::iterator_traits<_tValIt>::value_type>;
+	using difference_type = ptrdiff_t;
+	using reference = std::pair<const _tKey&, _tRef>;
+
+	struct pointer
+	{
+		reference ref;
+
+		reference*
+		operator->() noexcept
+		{
+			return std::addressof(ref);
+		}
+	};
+
+private:
+	_tKeyIt key_it{};
+	_tValIt val_it{};
+
+public:
+	flat_map_iterator() = default;
+	flat_map_iterator(_tKeyIt k, _tValIt v) noexcept : key_it(k), val_it(v)
+	{}
+	template<typename _tOtherRef, typename _tOtherValIt,
+		typename = enable_if_t<is_convertible<_tOtherValIt, _tValIt>::value>>
+	flat_map_iterator(const flat_map_iterator<_tKey, _tOtherRef, _tKeyIt,
+		_tOtherValIt>& i) noexcept
+		: key_it(i.key_it), val_it(i.val_it)
+	{}
+
+	_tKeyIt
+	key_iterator() const noexcept
+	{
+		return key_it;
+	}
+	_tValIt
+	value_iterator() const noexcept
+	{
+		return val_it;
+	}
+
+	reference
+	operator*() const
+	{
+		return {*key_it, *val_it};
+	}
+	pointer
+	operator->() const
+	{
+		return {**this};
+	}
+	reference
+	operator[](difference_type n) const
+	{
+		return *(*this + n);
+	}
+
+	flat_map_iterator&
+	operator++() noexcept
+	{
+		++key_it, ++val_it;
+		return *this;
+	}
+	flat_map_iterator
+	operator++(int) noexcept
+	{
+		auto i(*this);
+
+		++*this;
+		return i;
+	}
+	flat_map_iterator&
+	operator--() noexcept
+	{
+		--key_it, --val_it;
+		return *this;
+	}
+	flat_map_iterator
+	operator--(int) noexcept
+	{
+		auto i(*this);
+
+		--*this;
+		return i;
+	}
+	flat_map_iterator&
+	operator+=(difference_type n) noexcept
+	{
+		key_it += n, val_it += n;
+		return *this;
+	}
+	flat_map_iterator&
+	operator-=(difference_type n) noexcept
+	{
+		return *this += -n;
+	}
+	friend flat_map_iterator
+	operator+(flat_map_iterator i, difference_type n) noexcept
+	{
+		return i += n;
+	}
+	friend flat_map_iterator
+	operator+(difference_type n, flat_map_iterator i) noexcept
+	{
+		return i += n;
+	}
+	friend flat_map_iterator
+	operator-(flat_map_iterator i, difference_type n) noexcept
+	{
+		return i -= n;
+	}
+	friend difference_type
+	operator-(const flat_map_iterator& x, const flat_map_iterator& y) noexcept
+	{
+		return x.key_it - y.key_it;
+	}
+	friend bool
+	operator==(const flat_map_iterator& x, const flat_map_iterator& y) noexcept
+	{
+		return x.key_it == y.key_it;
+	}
+	friend bool
+	operator!=(const flat_map_iterator& x, const flat_map_iterator& y) noexcept
+	{
+		return !(x == y);
+	}
+	friend bool
+	operator<(const flat_map_iterator& x, const flat_map_iterator& y) noexcept
+	{
+		return x.key_it < y.key_it;
+	}
+	friend bool
+	operator>(const flat_map_iterator& x, const flat_map_iterator& y) noexcept
+	{
+		return y < x;
+	}
+	friend bool
+	operator<=(const flat_map_iterator& x, const flat_map_iterator& y) noexcept
+	{
+		return !(y < x);
+	}
+	friend bool
+	operator>=(const flat_map_iterator& x, const flat_map_iterator& y) noexcept
+	{
+		return !(x < y);
+	}
+};
+
+} // namespace details;
+
+/*!
+\brief 基于有序向量的映射
+\note 键和值分别存储在两个容器中，查找只访问连续的键序列。
+\note 批量插入只排序新元素并归并一次。
+\note 插入和删除使迭代器失效。
+*/
+template<typename _tKey, typename _tMapped, class _fComp = std::less<_tKey>,
+	class _tKeyCon = vector<_tKey>, class _tMappedCon = vector<_tMapped>>
+class flat_map
+{
+public:
+	using key_type = _tKey;
+	using mapped_type = _tMapped;
+	using value_type = std::pair<_tKey, _tMapped>;
+	using key_compare = _fComp;
+	using reference = std::pair<const key_type&, mapped_type&>;
+	using const_reference = std::pair<const key_type&, const mapped_type&>;
+	using key_container_type = _tKeyCon;
+	using mapped_container_type = _tMappedCon;
+	using size_type = typename key_container_type::size_type;
+	using difference_type = typename key_container_type::difference_type;
+	using iterator = details::flat_map_iterator<key_type, mapped_type&,
+		typename key_container_type::const_iterator,
+		typename mapped_container_type::iterator>;
+	using const_iterator = details::flat_map_iterator<key_type,
+		const mapped_type&, typename key_container_type::const_iterator,
+		typename mapped_container_type::const_iterator>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	struct containers
+	{
+		key_container_type keys;
+		mapped_container_type values;
+	};
+
+private:
+	containers c;
+	key_compare comp;
+
+public:
+	flat_map() = default;
+	explicit flat_map(const key_compare& cmp) : c(), comp(cmp)
+	{}
+	template<typename _tIn, typename = enable_for_input_iterator_t<_tIn>>
+	flat_map(_tIn first, _tIn last, const key_compare& cmp = key_compare())
+		: c(), comp(cmp)
+	{
+		insert(first, last);
+	}
+	flat_map(std::initializer_list<value_type> il,
+		const key_compare& cmp = key_compare())
+		: flat_map(il.begin(), il.end(), cmp)
+	{}
+
+	friend bool
+	operator==(const flat_map& x, const flat_map& y)
+	{
+		return x.c.keys == y.c.keys && x.c.values == y.c.values;
+	}
+	friend bool
+	operator!=(const flat_map& x, const flat_map& y)
+	{
+		return !(x == y);
+	}
+
+	iterator
+	begin() noexcept
+	{
+		return make_iterator(0);
+	}
+	const_iterator
+	begin() const noexcept
+	{
+		return make_iterator(0);
+	}
+	iterator
+	end() noexcept
+	{
+		return make_iterator(size());
+	}
+	const_iterator
+	end() const noexcept
+	{
+		return make_iterator(size());
+	}
+	const_iterator
+	cbegin() const noexcept
+	{
+		return begin();
+	}
+	const_iterator
+	cend() const noexcept
+	{
+		return end();
+	}
+	reverse_iterator
+	rbegin() noexcept
+	{
+		return reverse_iterator(end());
+	}
+	const_reverse_iterator
+	rbegin() const noexcept
+	{
+		return const_reverse_iterator(end());
+	}
+	reverse_iterator
+	rend() noexcept
+	{
+		return reverse_iterator(begin());
+	}
+	const_reverse_iterator
+	rend() const noexcept
+	{
+		return const_reverse_iterator(begin());
+	}
+
+	bool
+	empty() const noexcept
+	{
+		return c.keys.empty();
+	}
+	size_type
+	size() const noexcept
+	{
+		return c.keys.size();
+	}
+	size_type
+	max_size() const noexcept
+	{
+		return std::min<size_type>(c.keys.max_size(), c.values.max_size());
+	}
+	void
+	reserve(size_type n)
+	{
+		c.keys.reserve(n);
+		c.values.reserve(n);
+	}
+	void
+	clear() noexcept
+	{
+		c.keys.clear();
+		c.values.clear();
+	}
+	key_compare
+	key_comp() const
+	{
+		return comp;
+	}
+	const key_container_type&
+	keys() const noexcept
+	{
+		return c.keys;
+	}
+	const mapped_container_type&
+	values() const noexcept
+	{
+		return c.values;
+	}
+	//! \brief 取出底层容器，映射置为空
+	containers
+	extract() &&
+	{
+		containers res{std::move(c.keys), std::move(c.values)};
+
+		clear();
+		return res;
+	}
+
+	mapped_type&
+	operator[](const key_type& k)
+	{
+		return try_emplace(k).first->second;
+	}
+	mapped_type&
+	operator[](key_type&& k)
+	{
+		return try_emplace(std::move(k)).first->second;
+	}
+	mapped_type&
+	at(const key_type& k)
+	{
+		return at_impl(k);
+	}
+	const mapped_type&
+	at(const key_type& k) const
+	{
+		return const_cast<flat_map&>(*this).at_impl(k);
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	mapped_type&
+	at(const _tTrans& k)
+	{
+		return at_impl(k);
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	const mapped_type&
+	at(const _tTrans& k) const
+	{
+		return const_cast<flat_map&>(*this).at_impl(k);
+	}
+
+	template<typename... _tParams>
+	std::pair<iterator, bool>
+	emplace(_tParams&&... args)
+	{
+		value_type val(std::forward<_tParams>(args)...);
+
+		return try_emplace(std::move(val.first), std::move(val.second));
+	}
+	std::pair<iterator, bool>
+	insert(const value_type& val)
+	{
+		return try_emplace(val.first, val.second);
+	}
+	std::pair<iterator, bool>
+	insert(value_type&& val)
+	{
+		return try_emplace(std::move(val.first), std::move(val.second));
+	}
+	template<typename... _tParams>
+	std::pair<iterator, bool>
+	try_emplace(const key_type& k, _tParams&&... args)
+	{
+		return try_emplace_impl(k, std::forward<_tParams>(args)...);
+	}
+	template<typename... _tParams>
+	std::pair<iterator, bool>
+	try_emplace(key_type&& k, _tParams&&... args)
+	{
+		return try_emplace_impl(std::move(k), std::forward<_tParams>(args)...);
+	}
+	template<typename _tParam>
+	std::pair<iterator, bool>
+	insert_or_assign(const key_type& k, _tParam&& obj)
+	{
+		const auto r(try_emplace(k, std::forward<_tParam>(obj)));
+
+		if(!r.second)
+			r.first->second = std::forward<_tParam>(obj);
+		return r;
+	}
+	/*!
+	\brief 批量插入
+	\note 新元素追加到末尾，按键稳定排序后和原有元素归并一次；
+		键已存在的新元素被丢弃。
+	\note 复制或比较抛出异常时移除已追加的新元素；重排两个容器时
+		抛出异常则清空容器。
+	*/
+	template<typename _tIn, typename = enable_for_input_iterator_t<_tIn>>
+	void
+	insert(_tIn first, _tIn last)
+	{
+		const size_type old_size(size());
+
+		try
+		{
+			for(; first != last; ++first)
+			{
+				c.keys.emplace_back(first->first);
+				c.values.emplace_back(first->second);
+			}
+			sort_unique(old_size);
+		}
+		catch(...)
+		{
+			if(c.keys.size() > old_size)
+				c.keys.erase(c.keys.begin() + old_size, c.keys.end());
+			if(c.values.size() > old_size)
+				c.values.erase(c.values.begin() + old_size, c.values.end());
+			throw;
+		}
+	}
+	void
+	insert(std::initializer_list<value_type> il)
+	{
+		insert(il.begin(), il.end());
+	}
+
+	iterator
+	erase(const_iterator position)
+	{
+		return erase(position, position + 1);
+	}
+	iterator
+	erase(const_iterator first, const_iterator last)
+	{
+		const auto i(first - cbegin()), j(last - cbegin());
+
+		c.keys.erase(c.keys.begin() + i, c.keys.begin() + j);
+		c.values.erase(c.values.begin() + i, c.values.begin() + j);
+		return make_iterator(i);
+	}
+	size_type
+	erase(const key_type& k)
+	{
+		const auto i(find(k));
+
+		if(i != end())
+		{
+			erase(i);
+			return 1;
+		}
+		return 0;
+	}
+	void
+	swap(flat_map& x) noexcept
+	{
+		using std::swap;
+
+		c.keys.swap(x.c.keys);
+		c.values.swap(x.c.values);
+		swap(comp, x.comp);
+	}
+	friend void
+	swap(flat_map& x, flat_map& y) noexcept
+	{
+		x.swap(y);
+	}
+
+	iterator
+	find(const key_type& k)
+	{
+		return make_iterator(find_index(k));
+	}
+	const_iterator
+	find(const key_type& k) const
+	{
+		return make_iterator(find_index(k));
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	iterator
+	find(const _tTrans& k)
+	{
+		return make_iterator(find_index(k));
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	const_iterator
+	find(const _tTrans& k) const
+	{
+		return make_iterator(find_index(k));
+	}
+	size_type
+	count(const key_type& k) const
+	{
+		return find_index(k) != size();
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	size_type
+	count(const _tTrans& k) const
+	{
+		return find_index(k) != size();
+	}
+	bool
+	contains(const key_type& k) const
+	{
+		return find_index(k) != size();
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	bool
+	contains(const _tTrans& k) const
+	{
+		return find_index(k) != size();
+	}
+	iterator
+	lower_bound(const key_type& k)
+	{
+		return make_iterator(lower_index(k));
+	}
+	const_iterator
+	lower_bound(const key_type& k) const
+	{
+		return make_iterator(lower_index(k));
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	iterator
+	lower_bound(const _tTrans& k)
+	{
+		return make_iterator(lower_index(k));
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	const_iterator
+	lower_bound(const _tTrans& k) const
+	{
+		return make_iterator(lower_index(k));
+	}
+	iterator
+	upper_bound(const key_type& k)
+	{
+		return make_iterator(upper_index(k));
+	}
+	const_iterator
+	upper_bound(const key_type& k) const
+	{
+		return make_iterator(upper_index(k));
+	}
+
+private:
+	iterator
+	make_iterator(size_type i) noexcept
+	{
+		return iterator(c.keys.cbegin() + i, c.values.begin() + i);
+	}
+	const_iterator
+	make_iterator(size_type i) const noexcept
+	{
+		return const_iterator(c.keys.cbegin() + i, c.values.cbegin() + i);
+	}
+	template<typename _tParam>
+	size_type
+	lower_index(const _tParam& k) const
+	{
+		return details::branchless_lower_bound(
+				   c.keys.begin(), c.keys.end(), k, comp)
+			- c.keys.begin();
+	}
+	template<typename _tParam>
+	size_type
+	upper_index(const _tParam& k) const
+	{
+		return details::branchless_upper_bound(
+				   c.keys.begin(), c.keys.end(), k, comp)
+			- c.keys.begin();
+	}
+	//! \brief 查找键的下标，不存在时返回 size()
+	template<typename _tParam>
+	size_type
+	find_index(const _tParam& k) const
+	{
+		const size_type i(lower_index(k));
+
+		return i != size() && !comp(k, c.keys[i]) ? i : size();
+	}
+	template<typename _tParam>
+	mapped_type&
+	at_impl(const _tParam& k)
+	{
+		const size_type i(find_index(k));
+
+		if(i == size())
+			throw std::out_of_range("flat_map::at: key not found");
+		return c.values[i];
+	}
+	template<typename _tParam, typename... _tParams>
+	std::pair<iterator, bool>
+	try_emplace_impl(_tParam&& k, _tParams&&... args)
+	{
+		const size_type i(lower_index(k));
+
+		if(i != size() && !comp(k, c.keys[i]))
+			return {make_iterator(i), false};
+		c.keys.emplace(c.keys.begin() + i, std::forward<_tParam>(k));
+		try
+		{
+			c.values.emplace(
+				c.values.begin() + i, std::forward<_tParams>(args)...);
+		}
+		catch(...)
+		{
+			c.keys.erase(c.keys.begin() + i);
+			throw;
+		}
+		return {make_iterator(i), true};
+	}
+	/*!
+	\brief 排序下标 mid 之后的新元素并和之前的有序元素归并
+	\note 按键排序下标的置换后一次性重排两个容器；等价键保留最早的元素。
+	*/
+	void
+	sort_unique(size_type mid)
+	{
+		const size_type n(size());
+
+		if(mid == n)
+			return;
+
+		vector<size_type> order(n);
+
+		for(size_type i(0); i < n; ++i)
+			order[i] = i;
+
+		const auto key_less = [this](size_type x, size_type y) {
+			return comp(c.keys[x], c.keys[y]);
+		};
+
+		std::stable_sort(order.begin() + mid, order.end(), key_less);
+		std::inplace_merge(
+			order.begin(), order.begin() + mid, order.end(), key_less);
+
+		key_container_type keys;
+		mapped_container_type values;
+
+		keys.reserve(n);
+		values.reserve(n);
+		try
+		{
+			for(const auto i : order)
+				if(keys.empty() || comp(keys.back(), c.keys[i]))
+				{
+					keys.push_back(std::move(c.keys[i]));
+					values.push_back(std::move(c.values[i]));
+				}
+		}
+		catch(...)
+		{
+			// some elements have been moved out
+			clear();
+			throw;
+		}
+		c.keys = std::move(keys);
+		c.values = std::move(values);
+	}
+};
+
+}
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+#include "vector.hpp"
+
+namespace cxx
+{
+
+namespace details
+{
+
+/*!
+\brief 无分支的二分查找下界
+\note 每次迭代只有一次比较和条件传送，没有依赖比较结果的跳转，
+	适合编译器生成 cmov 指令，避免在随机查询时的分支预测失败。
+*/
+template<typename _tRan, typename _tKey, class _fComp>
+_tRan
+branchless_lower_bound(_tRan first, _tRan last, const _tKey& k, _fComp comp)
+{
+	auto n(last - first);
+
+	if(n == 0)
+		return first;
+	while(n > 1)
+	{
+		const auto half(n / 2);
+
+		first = comp(first[half], k) ? first + half : first;
+		n -= half;
+	}
+	return first + comp(*first, k);
+}
+
+template<typename _tRan, typename _tKey, class _fComp>
+inline _tRan
+branchless_upper_bound(_tRan first, _tRan last, const _tKey& k, _fComp comp)
+{
+	return details::branchless_lower_bound(first, last, k,
+		[&](const typename std::iterator_traits<_tRan>::value_type& x,
+			const _tKey& y) { return !comp(y, x); });
+}
+
+template<class _fComp, typename _tKey, typename = void>
+struct is_transparent_for : false_
+{};
+
+template<class _fComp, typename _tKey>
+struct is_transparent_for<_fComp, _tKey,
+	void_t<typename _fComp::is_transparent>> : true_
+{};
+
+//! \brief 异质查找：仅当比较器透明时参与重载决议
+template<class _fComp, typename _tKey, typename _type = void>
+using enable_transparent_t
+	= enable_if_t<is_transparent_for<_fComp, _tKey>::value, _type>;
+
+} // namespace details;
+
+/*!
+\brief 基于有序向量的集合
+\note 元素连续存储，查找为连续内存上的二分查找。
+\note 批量插入只排序新元素并归并一次。
+\note 插入和删除使迭代器失效。
+*/
+template<typename _tKey, class _fComp = std::less<_tKey>,
+	class _tCon = vector<_tKey>>
+class flat_set
+{
+public:
+	using key_type = _tKey;
+	using value_type = _tKey;
+	using key_compare = _fComp;
+	using value_compare = _fComp;
+	using container_type = _tCon;
+	using size_type = typename container_type::size_type;
+	using difference_type = typename container_type::difference_type;
+	using reference = value_type&;
+	using const_reference = const value_type&;
+	using iterator = typename container_type::const_iterator;
+	using const_iterator = typename container_type::const_iterator;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+private:
+	container_type con;
+	key_compare comp;
+
+public:
+	flat_set() = default;
+	explicit flat_set(const key_compare& c) : con(), comp(c)
+	{}
+	explicit flat_set(container_type c, const key_compare& cmp = key_compare())
+		: con(std::move(c)), comp(cmp)
+	{
+		sort_unique(con.begin());
+	}
+	template<typename _tIn, typename = enable_for_input_iterator_t<_tIn>>
+	flat_set(_tIn first, _tIn last, const key_compare& c = key_compare())
+		: con(), comp(c)
+	{
+		insert(first, last);
+	}
+	flat_set(std::initializer_list<value_type> il,
+		const key_compare& c = key_compare())
+		: flat_set(il.begin(), il.end(), c)
+	{}
+
+	friend bool
+	operator==(const flat_set& x, const flat_set& y)
+	{
+		return x.con == y.con;
+	}
+	friend bool
+	operator!=(const flat_set& x, const flat_set& y)
+	{
+		return !(x == y);
+	}
+
+	iterator
+	begin() const noexcept
+	{
+		return con.begin();
+	}
+	iterator
+	end() const noexcept
+	{
+		return con.end();
+	}
+	const_iterator
+	cbegin() const noexcept
+	{
+		return con.cbegin();
+	}
+	const_iterator
+	cend() const noexcept
+	{
+		return con.cend();
+	}
+	const_reverse_iterator
+	rbegin() const noexcept
+	{
+		return const_reverse_iterator(end());
+	}
+	const_reverse_iterator
+	rend() const noexcept
+	{
+		return const_reverse_iterator(begin());
+	}
+
+	bool
+	empty() const noexcept
+	{
+		return con.empty();
+	}
+	size_type
+	size() const noexcept
+	{
+		return con.size();
+	}
+	size_type
+	max_size() const noexcept
+	{
+		return con.max_size();
+	}
+	void
+	reserve(size_type n)
+	{
+		con.reserve(n);
+	}
+	void
+	clear() noexcept
+	{
+		con.clear();
+	}
+	key_compare
+	key_comp() const
+	{
+		return comp;
+	}
+	value_compare
+	value_comp() const
+	{
+		return comp;
+	}
+	//! \brief 取出底层容器，集合置为空
+	container_type
+	extract() &&
+	{
+		container_type res(std::move(con));
+
+		con.clear();
+		return res;
+	}
+	const container_type&
+	get_container() const noexcept
+	{
+		return con;
+	}
+
+	template<typename... _tParams>
+	std::pair<iterator, bool>
+	emplace(_tParams&&... args)
+	{
+		return insert(value_type(std::forward<_tParams>(args)...));
+	}
+	std::pair<iterator, bool>
+	insert(const value_type& val)
+	{
+		return insert_unique(val);
+	}
+	std::pair<iterator, bool>
+	insert(value_type&& val)
+	{
+		return insert_unique(std::move(val));
+	}
+	/*!
+	\brief 批量插入
+	\note 新元素追加到末尾后排序，再和原有元素归并，已有的等价元素保留。
+	\note 复制或排序新元素时抛出异常则移除已追加的新元素；
+		归并时抛出异常则清空容器。
+	*/
+	template<typename _tIn, typename = enable_for_input_iterator_t<_tIn>>
+	void
+	insert(_tIn first, _tIn last)
+	{
+		const size_type old_size(con.size());
+
+		try
+		{
+			con.insert(con.end(), first, last);
+			sort_unique(con.begin() + old_size);
+		}
+		catch(...)
+		{
+			if(con.size() > old_size)
+				con.erase(con.begin() + old_size, con.end());
+			throw;
+		}
+	}
+	void
+	insert(std::initializer_list<value_type> il)
+	{
+		insert(il.begin(), il.end());
+	}
+
+	iterator
+	erase(const_iterator position)
+	{
+		return con.erase(position);
+	}
+	iterator
+	erase(const_iterator first, const_iterator last)
+	{
+		return con.erase(first, last);
+	}
+	size_type
+	erase(const key_type& k)
+	{
+		const auto r(equal_range(k));
+		const size_type n(r.second - r.first);
+
+		con.erase(r.first, r.second);
+		return n;
+	}
+	void
+	swap(flat_set& x) noexcept(noexcept(x.con.swap(x.con)))
+	{
+		using std::swap;
+
+		con.swap(x.con);
+		swap(comp, x.comp);
+	}
+	friend void
+	swap(flat_set& x, flat_set& y) noexcept(noexcept(x.swap(y)))
+	{
+		x.swap(y);
+	}
+
+	iterator
+	find(const key_type& k) const
+	{
+		return find_impl(k);
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	iterator
+	find(const _tTrans& k) const
+	{
+		return find_impl(k);
+	}
+	size_type
+	count(const key_type& k) const
+	{
+		return find(k) != end();
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	size_type
+	count(const _tTrans& k) const
+	{
+		return find(k) != end();
+	}
+	bool
+	contains(const key_type& k) const
+	{
+		return find(k) != end();
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	bool
+	contains(const _tTrans& k) const
+	{
+		return find(k) != end();
+	}
+	iterator
+	lower_bound(const key_type& k) const
+	{
+		return details::branchless_lower_bound(begin(), end(), k, comp);
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	iterator
+	lower_bound(const _tTrans& k) const
+	{
+		return details::branchless_lower_bound(begin(), end(), k, comp);
+	}
+	iterator
+	upper_bound(const key_type& k) const
+	{
+		return details::branchless_upper_bound(begin(), end(), k, comp);
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	iterator
+	upper_bound(const _tTrans& k) const
+	{
+		return details::branchless_upper_bound(begin(), end(), k, comp);
+	}
+	std::pair<iterator, iterator>
+	equal_range(const key_type& k) const
+	{
+		const auto i(lower_bound(k));
+
+		return {i, i != end() && !comp(k, *i) ? i + 1 : i};
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_t<key_compare, _tTrans>>
+	std::pair<iterator, iterator>
+	equal_range(const _tTrans& k) const
+	{
+		return {lower_bound(k), upper_bound(k)};
+	}
+
+private:
+	template<typename _tParam>
+	iterator
+	find_impl(const _tParam& k) const
+	{
+		const auto i(details::branchless_lower_bound(begin(), end(), k, comp));
+
+		return i != end() && !comp(k, *i) ? i : end();
+	}
+	template<typename _tParam>
+	std::pair<iterator, bool>
+	insert_unique(_tParam&& val)
+	{
+		const auto i(lower_bound(val));
+
+		if(i != end() && !comp(val, *i))
+			return {i, false};
+		return {con.insert(i, std::forward<_tParam>(val)), true};
+	}
+	//! \brief 排序 [mid, end) 并和已经有序的 [begin, mid) 归并，移除等价元素
+	void
+	sort_unique(typename container_type::iterator mid)
+	{
+		const auto first(con.begin()), last(con.end());
+
+		std::stable_sort(mid, last, comp);
+		try
+		{
+			std::inplace_merge(first, mid, last, comp);
+			con.erase(std::unique(first, last,
+						  [this](const value_type& x, const value_type& y) {
+							  return !comp(x, y);
+						  }),
+				last);
+		}
+		catch(...)
+		{
+			// the old elements may have been moved
+			con.clear();
+			throw;
+		}
+	}
+};
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+
+namespace cxx
+{
+
+/*!
+\brief 容器增长策略
+
+增长策略提供静态成员函数
+	size_t next_capacity(size_t cap, size_t n, size_t max_n, size_t obj_size)
+在容量 cap 不足以再放入 n 个元素时给出新的容量。
+结果不小于 cap + n 且不超过 max_n；调用者保证 cap + n 不超过 max_n 。
+obj_size 是元素的大小，用于按字节对齐的策略。
+所有计算使用整数，溢出时取 max_n 。
+*/
+
+namespace details
+{
+
+inline size_t
+saturated_add(size_t x, size_t y, size_t lim) noexcept
+{
+	return x > lim || y > lim - x ? lim : x + y;
+}
+
+//! \brief 计算 cap * _vNum / _vDen ，溢出或超过 lim 时返回 lim
+template<size_t _vNum, size_t _vDen>
+inline size_t
+saturated_scale(size_t cap, size_t lim) noexcept
+{
+	static_assert(_vDen != 0, "Invalid denominator found.");
+
+	const size_t q(cap / _vDen), r(cap % _vDen);
+
+	return q > lim / _vNum ? lim
+						   : saturated_add(q * _vNum, r * _vNum / _vDen, lim);
+}
+
+} // namespace details;
+
+/*!
+\brief 几何增长：新容量为 cap * _vNum / _vDen + n
+*/
+template<size_t _vNum = 3, size_t _vDen = 2>
+struct geometric_growth
+{
+	static_assert(_vNum >= _vDen, "Shrinking growth factor found.");
+
+	static size_t
+	next_capacity(size_t cap, size_t n, size_t max_n, size_t) noexcept
+	{
+		return details::saturated_add(
+			details::saturated_scale<_vNum, _vDen>(cap, max_n), n, max_n);
+	}
+};
+
+using doubling_growth = geometric_growth<2, 1>;
+
+/*!
+\brief 线性增长：每次增加 _vChunk 的整数倍个元素
+*/
+template<size_t _vChunk>
+struct linear_growth
+{
+	static_assert(_vChunk != 0, "Invalid chunk size found.");
+
+	static size_t
+	next_capacity(size_t cap, size_t n, size_t max_n, size_t) noexcept
+	{
+		const size_t chunks(n / _vChunk + (n % _vChunk != 0));
+
+		return chunks > max_n / _vChunk
+			? max_n
+			: details::saturated_add(cap, chunks * _vChunk, max_n);
+	}
+};
+
+/*!
+\brief 按分配器尺寸类对齐的增长
+\note 在基础策略的结果上把字节数向上取整到 jemalloc 风格的尺寸类：
+	不超过 128 字节时以 16 字节为间隔，之后每个 2 的幂区间均分为 4 类。
+	malloc 的实现通常会把请求补齐到同样或更细的粒度，多出的空间因此可以
+	直接作为容量使用。
+*/
+template<class _tBase = geometric_growth<>>
+struct size_class_growth
+{
+	static size_t
+	round_size_class(size_t bytes) noexcept
+	{
+		if(bytes <= 8)
+			return 8;
+		if(bytes <= 128)
+			return (bytes + 15) & ~size_t(15);
+
+		size_t spacing(1);
+
+		for(size_t v((bytes - 1) >> 2); v > 1; v >>= 1)
+			spacing <<= 1;
+		return bytes + (spacing - 1) < bytes
+			? bytes
+			: (bytes + (spacing - 1)) & ~(spacing - 1);
+	}
+
+	static size_t
+	next_capacity(size_t cap, size_t n, size_t max_n, size_t obj_size) noexcept
+	{
+		const size_t res(_tBase::next_capacity(cap, n, max_n, obj_size));
+
+		if(obj_size == 0 || res > max_n / obj_size)
+			return res;
+
+		const size_t rounded(round_size_class(res * obj_size) / obj_size);
+
+		return rounded < max_n ? rounded : max_n;
+	}
+};
+
+using default_growth = geometric_growth<>;
+
+}
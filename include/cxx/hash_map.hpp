@@ -0,0 +1,830 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include "meta.hpp"
+#if defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define CXX_HASH_MAP_SSE2 1
+#endif
+
+namespace cxx
+{
+
+namespace details
+{
+
+/*!
+\brief 开放寻址散列表的控制字节
+\note 满的槽存放散列值的低 7 位，因此非负；空槽和删除标记为负。
+*/
+enum ctrl_t : signed char
+{
+	ctrl_empty = -128,
+	ctrl_deleted = -2,
+	ctrl_sentinel = -1
+};
+
+constexpr size_t ctrl_group_width = 16;
+
+struct alignas(ctrl_group_width) ctrl_group
+{
+	signed char bytes[ctrl_group_width];
+};
+
+inline unsigned
+countr_zero(unsigned x) noexcept
+{
+	assert(x != 0);
+#if defined(__GNUC__) || defined(__clang__)
+	return unsigned(__builtin_ctz(x));
+#else
+	unsigned n(0);
+
+	for(; (x & 1) == 0; x >>= 1)
+		++n;
+	return n;
+#endif
+}
+
+/*!
+\brief 一组 16 个控制字节的并行匹配
+\note 支持 SSE2 时一次比较整组，否则逐字节比较。结果为位掩码，第 i 位
+	对应第 i 个控制字节。
+*/
+class probe_group
+{
+private:
+#if CXX_HASH_MAP_SSE2
+	__m128i ctrl;
+#else
+	const signed char* ctrl;
+#endif
+
+public:
+	explicit probe_group(const ctrl_group& g) noexcept
+#if CXX_HASH_MAP_SSE2
+		: ctrl(_mm_load_si128(reinterpret_cast<const __m128i*>(g.bytes)))
+#else
+		: ctrl(g.bytes)
+#endif
+	{}
+
+	unsigned
+	match(signed char h2) const noexcept
+	{
+#if CXX_HASH_MAP_SSE2
+		return unsigned(
+			_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)));
+#else
+		unsigned res(0);
+
+		for(size_t i(0); i < ctrl_group_width; ++i)
+			res |= unsigned(ctrl[i] == h2) << i;
+		return res;
+#endif
+	}
+	unsigned
+	match_empty() const noexcept
+	{
+		return match(ctrl_empty);
+	}
+	unsigned
+	match_empty_or_deleted() const noexcept
+	{
+#if CXX_HASH_MAP_SSE2
+		return unsigned(_mm_movemask_epi8(
+			_mm_cmplt_epi8(ctrl, _mm_set1_epi8(ctrl_sentinel))));
+#else
+		unsigned res(0);
+
+		for(size_t i(0); i < ctrl_group_width; ++i)
+			res |= unsigned(ctrl[i] < ctrl_sentinel) << i;
+		return res;
+#endif
+	}
+};
+
+//! \brief 混合散列值，使低位和高位都依赖于所有输入位
+inline size_t
+mix_hash(size_t h) noexcept
+{
+	const std::uint64_t m(0x9E3779B97F4A7C15ULL);
+	const std::uint64_t x(std::uint64_t(h) * m);
+
+	return size_t(x ^ (x >> 32));
+}
+
+template<class _fHash, class _fEqual, typename _tKey, typename = void>
+struct is_transparent_hash : false_
+{};
+
+template<class _fHash, class _fEqual, typename _tKey>
+struct is_transparent_hash<_fHash, _fEqual, _tKey,
+	void_t<typename _fHash::is_transparent, typename _fEqual::is_transparent>>
+	: true_
+{};
+
+//! \brief 异质查找：仅当散列函数和相等谓词都透明时参与重载决议
+template<class _fHash, class _fEqual, typename _tKey, typename _type = void>
+using enable_transparent_hash_t = enable_if_t<
+	is_transparent_hash<_fHash, _fEqual, _tKey>::value, _type>;
+
+} // namespace details;
+
+/*!
+\brief 开放寻址散列映射
+\note 采用 SwissTable 的布局：槽按 16 个一组，每个槽有一个控制字节记录
+	散列值的 7 位。查找时整组并行比较控制字节，只有匹配的槽才比较键。
+	组之间按三角数序列探测。
+\note 散列函数和相等谓词都有 is_transparent 时支持异质查找，
+	例如以 string_view 查找 string 键而不构造临时对象。
+\note 解引用迭代器得到 std::pair<const _tKey&, _tMapped&> 代理对象。
+\note 插入可能使所有迭代器失效；删除只使被删除元素的迭代器失效。
+*/
+template<typename _tKey, typename _tMapped, class _fHash = std::hash<_tKey>,
+	class _fEqual = std::equal_to<_tKey>,
+	class _tAlloc = std::allocator<std::pair<const _tKey, _tMapped>>>
+class hash_map
+{
+public:
+	using key_type = _tKey;
+	using mapped_type = _tMapped;
+	using value_type = std::pair<const _tKey, _tMapped>;
+	using size_type = size_t;
+	using difference_type = ptrdiff_t;
+	using hasher = _fHash;
+	using key_equal = _fEqual;
+	using allocator_type = _tAlloc;
+
+private:
+	using slot_type = std::pair<_tKey, _tMapped>;
+	using slot_allocator = rebind_alloc_t<_tAlloc, slot_type>;
+	using slot_traits = allocator_traits<slot_allocator>;
+	using group_allocator = rebind_alloc_t<_tAlloc, details::ctrl_group>;
+	using group_traits = allocator_traits<group_allocator>;
+	using ctrl_pointer = signed char*;
+
+	template<typename _tRef, typename _tSlot>
+	class iterator_base
+	{
+		friend class hash_map;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = typename hash_map::value_type;
+		using difference_type = ptrdiff_t;
+		using reference = std::pair<const _tKey&, _tRef>;
+
+		struct pointer
+		{
+			reference ref;
+
+			reference*
+			operator->() noexcept
+			{
+				return std::addressof(ref);
+			}
+		};
+
+	private:
+		const signed char* ctrl = {};
+		_tSlot* slot = {};
+
+		iterator_base(const signed char* c, _tSlot* s) noexcept
+			: ctrl(c), slot(s)
+		{
+			skip_empty();
+		}
+
+	public:
+		iterator_base() = default;
+		template<typename _tOtherRef, typename _tOtherSlot,
+			typename = enable_if_t<is_convertible<_tOtherSlot*, _tSlot*>::value>>
+		iterator_base(const iterator_base<_tOtherRef, _tOtherSlot>& i) noexcept
+			: ctrl(i.ctrl), slot(i.slot)
+		{}
+
+		reference
+		operator*() const noexcept
+		{
+			return {slot->first, slot->second};
+		}
+		pointer
+		operator->() const noexcept
+		{
+			return {**this};
+		}
+		iterator_base&
+		operator++() noexcept
+		{
+			++ctrl, ++slot;
+			skip_empty();
+			return *this;
+		}
+		iterator_base
+		operator++(int) noexcept
+		{
+			auto i(*this);
+
+			++*this;
+			return i;
+		}
+		friend bool
+		operator==(const iterator_base& x, const iterator_base& y) noexcept
+		{
+			return x.slot == y.slot;
+		}
+		friend bool
+		operator!=(const iterator_base& x, const iterator_base& y) noexcept
+		{
+			return !(x == y);
+		}
+
+	private:
+		//! \note 控制字节末尾有一个 ctrl_sentinel 作为哨兵。
+		void
+		skip_empty() noexcept
+		{
+			if(ctrl)
+				while(*ctrl < details::ctrl_sentinel)
+					++ctrl, ++slot;
+		}
+
+		template<typename, typename>
+		friend class iterator_base;
+	};
+
+public:
+	using iterator = iterator_base<_tMapped&, slot_type>;
+	using const_iterator = iterator_base<const _tMapped&, const slot_type>;
+
+private:
+	struct components : slot_allocator, hasher, key_equal
+	{
+		ctrl_pointer ctrl = {};
+		slot_type* slots = {};
+		//! \brief 槽数，为 0 或 16 的 2 的幂倍
+		size_type capacity = 0;
+		size_type size = 0;
+		//! \brief 不需要重散列时还能占用的空槽数
+		size_type growth_left = 0;
+
+		components() = default;
+		components(const hasher& h, const key_equal& eq,
+			const slot_allocator& a)
+			: slot_allocator(a), hasher(h), key_equal(eq)
+		{}
+	};
+	components objects;
+
+public:
+	hash_map() = default;
+	explicit hash_map(size_type n, const hasher& h = hasher(),
+		const key_equal& eq = key_equal(),
+		const allocator_type& a = allocator_type())
+		: objects(h, eq, slot_allocator(a))
+	{
+		reserve(n);
+	}
+	hash_map(std::initializer_list<value_type> il)
+	{
+		reserve(il.size());
+		for(const auto& val : il)
+			insert(val);
+	}
+	hash_map(const hash_map& x)
+		: objects(x.hash_function(), x.key_eq(),
+			  slot_traits::select_on_container_copy_construction(
+				  x.get_slot_allocator()))
+	{
+		reserve(x.size());
+		for(const auto& val : x)
+			emplace_new(hash_of(val.first), val.first, val.second);
+	}
+	hash_map(hash_map&& x) noexcept : objects(std::move(x.objects))
+	{
+		x.reset_storage();
+	}
+	~hash_map()
+	{
+		release_storage();
+	}
+
+	hash_map&
+	operator=(hash_map x) noexcept
+	{
+		swap(x);
+		return *this;
+	}
+
+	allocator_type
+	get_allocator() const noexcept
+	{
+		return allocator_type(get_slot_allocator());
+	}
+	hasher
+	hash_function() const
+	{
+		return objects;
+	}
+	key_equal
+	key_eq() const
+	{
+		return objects;
+	}
+
+	iterator
+	begin() noexcept
+	{
+		return {objects.ctrl, objects.slots};
+	}
+	const_iterator
+	begin() const noexcept
+	{
+		return {objects.ctrl, objects.slots};
+	}
+	iterator
+	end() noexcept
+	{
+		return {nullptr, objects.slots + objects.capacity};
+	}
+	const_iterator
+	end() const noexcept
+	{
+		return {nullptr, objects.slots + objects.capacity};
+	}
+	const_iterator
+	cbegin() const noexcept
+	{
+		return begin();
+	}
+	const_iterator
+	cend() const noexcept
+	{
+		return end();
+	}
+
+	bool
+	empty() const noexcept
+	{
+		return objects.size == 0;
+	}
+	size_type
+	size() const noexcept
+	{
+		return objects.size;
+	}
+	size_type
+	capacity() const noexcept
+	{
+		return objects.capacity;
+	}
+	float
+	load_factor() const noexcept
+	{
+		return capacity() == 0 ? 0.F : float(size()) / float(capacity());
+	}
+
+	void
+	clear() noexcept
+	{
+		destroy_slots();
+		if(objects.capacity != 0)
+			std::memset(objects.ctrl, details::ctrl_empty, objects.capacity);
+		objects.size = 0;
+		objects.growth_left = max_load(objects.capacity);
+	}
+	//! \brief 保证插入总共 n 个元素时不需要重散列
+	void
+	reserve(size_type n)
+	{
+		if(n > size() + objects.growth_left)
+			rehash(capacity_for(n));
+	}
+
+	iterator
+	find(const key_type& k)
+	{
+		return make_iterator(find_slot(k, hash_of(k)));
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_hash_t<_fHash, _fEqual, _tTrans>>
+	iterator
+	find(const _tTrans& k)
+	{
+		return make_iterator(find_slot(k, hash_of(k)));
+	}
+	const_iterator
+	find(const key_type& k) const
+	{
+		return make_iterator(find_slot(k, hash_of(k)));
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_hash_t<_fHash, _fEqual, _tTrans>>
+	const_iterator
+	find(const _tTrans& k) const
+	{
+		return make_iterator(find_slot(k, hash_of(k)));
+	}
+	bool
+	contains(const key_type& k) const
+	{
+		return find_slot(k, hash_of(k)) != no_slot;
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_hash_t<_fHash, _fEqual, _tTrans>>
+	bool
+	contains(const _tTrans& k) const
+	{
+		return find_slot(k, hash_of(k)) != no_slot;
+	}
+	size_type
+	count(const key_type& k) const
+	{
+		return contains(k);
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_hash_t<_fHash, _fEqual, _tTrans>>
+	size_type
+	count(const _tTrans& k) const
+	{
+		return contains(k);
+	}
+	mapped_type&
+	at(const key_type& k)
+	{
+		return at_impl(k);
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_hash_t<_fHash, _fEqual, _tTrans>>
+	mapped_type&
+	at(const _tTrans& k)
+	{
+		return at_impl(k);
+	}
+	const mapped_type&
+	at(const key_type& k) const
+	{
+		return const_cast<hash_map&>(*this).at_impl(k);
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_hash_t<_fHash, _fEqual, _tTrans>>
+	const mapped_type&
+	at(const _tTrans& k) const
+	{
+		return const_cast<hash_map&>(*this).at_impl(k);
+	}
+	mapped_type&
+	operator[](const key_type& k)
+	{
+		return try_emplace(k).first->second;
+	}
+	mapped_type&
+	operator[](key_type&& k)
+	{
+		return try_emplace(std::move(k)).first->second;
+	}
+
+	template<typename _tParam, typename... _tParams>
+	std::pair<iterator, bool>
+	try_emplace(_tParam&& k, _tParams&&... args)
+	{
+		const size_t h(hash_of(k));
+		const size_type i(find_slot(k, h));
+
+		if(i != no_slot)
+			return {make_iterator(i), false};
+		return {make_iterator(emplace_new(h, std::forward<_tParam>(k),
+					std::forward<_tParams>(args)...)),
+			true};
+	}
+	std::pair<iterator, bool>
+	insert(const value_type& val)
+	{
+		return try_emplace(val.first, val.second);
+	}
+	std::pair<iterator, bool>
+	insert(std::pair<_tKey, _tMapped>&& val)
+	{
+		return try_emplace(std::move(val.first), std::move(val.second));
+	}
+	template<typename _tParam, typename _tValue>
+	std::pair<iterator, bool>
+	insert_or_assign(_tParam&& k, _tValue&& obj)
+	{
+		const auto r(try_emplace(std::forward<_tParam>(k),
+			std::forward<_tValue>(obj)));
+
+		if(!r.second)
+			r.first->second = std::forward<_tValue>(obj);
+		return r;
+	}
+
+	void
+	erase(iterator position) noexcept
+	{
+		erase_slot(size_type(position.slot - objects.slots));
+	}
+	void
+	erase(const_iterator position) noexcept
+	{
+		erase_slot(size_type(position.slot - objects.slots));
+	}
+	size_type
+	erase(const key_type& k)
+	{
+		return erase_key(k);
+	}
+	template<typename _tTrans,
+		typename = details::enable_transparent_hash_t<_fHash, _fEqual, _tTrans>>
+	size_type
+	erase(const _tTrans& k)
+	{
+		return erase_key(k);
+	}
+
+	void
+	swap(hash_map& x) noexcept
+	{
+		using std::swap;
+
+		swap(static_cast<hasher&>(objects), static_cast<hasher&>(x.objects));
+		swap(static_cast<key_equal&>(objects),
+			static_cast<key_equal&>(x.objects));
+		swap_allocator(x,
+			typename slot_traits::propagate_on_container_swap());
+		swap(objects.ctrl, x.objects.ctrl);
+		swap(objects.slots, x.objects.slots);
+		swap(objects.capacity, x.objects.capacity);
+		swap(objects.size, x.objects.size);
+		swap(objects.growth_left, x.objects.growth_left);
+	}
+	friend void
+	swap(hash_map& x, hash_map& y) noexcept
+	{
+		x.swap(y);
+	}
+
+private:
+	static constexpr size_type no_slot = size_type(-1);
+
+	slot_allocator&
+	get_slot_allocator() noexcept
+	{
+		return objects;
+	}
+	const slot_allocator&
+	get_slot_allocator() const noexcept
+	{
+		return objects;
+	}
+	void
+	swap_allocator(hash_map& x, true_) noexcept
+	{
+		using std::swap;
+
+		swap(get_slot_allocator(), x.get_slot_allocator());
+	}
+	void
+	swap_allocator(hash_map&, false_) noexcept
+	{}
+
+	template<typename _tParam>
+	mapped_type&
+	at_impl(const _tParam& k)
+	{
+		const size_type i(find_slot(k, hash_of(k)));
+
+		if(i == no_slot)
+			throw std::out_of_range("hash_map::at: key not found");
+		return objects.slots[i].second;
+	}
+	template<typename _tParam>
+	size_type
+	erase_key(const _tParam& k)
+	{
+		const size_type i(find_slot(k, hash_of(k)));
+
+		if(i == no_slot)
+			return 0;
+		erase_slot(i);
+		return 1;
+	}
+	template<typename _tParam>
+	size_t
+	hash_of(const _tParam& k) const
+	{
+		return details::mix_hash(static_cast<const hasher&>(objects)(k));
+	}
+	static signed char
+	h2(size_t h) noexcept
+	{
+		return static_cast<signed char>(h & 0x7F);
+	}
+	//! \brief 最大负载因子为 7/8
+	static size_type
+	max_load(size_type cap) noexcept
+	{
+		return cap - cap / 8;
+	}
+	static size_type
+	capacity_for(size_type n) noexcept
+	{
+		size_type cap(details::ctrl_group_width);
+
+		while(max_load(cap) < n)
+			cap *= 2;
+		return cap;
+	}
+
+	iterator
+	make_iterator(size_type i) noexcept
+	{
+		return i == no_slot ? end()
+							: iterator(objects.ctrl + i, objects.slots + i);
+	}
+	const_iterator
+	make_iterator(size_type i) const noexcept
+	{
+		return i == no_slot
+			? end()
+			: const_iterator(objects.ctrl + i, objects.slots + i);
+	}
+
+	/*!
+	\brief 按三角数序列依次访问各组
+	\note 组数是 2 的幂时三角数序列不重复地覆盖所有组。
+	*/
+	template<typename _fVisit>
+	size_type
+	probe(size_t h, _fVisit visit) const
+	{
+		const size_type mask(objects.capacity / details::ctrl_group_width - 1);
+		size_type g((h >> 7) & mask);
+
+		for(size_type step(1);; ++step)
+		{
+			const auto& group(
+				reinterpret_cast<const details::ctrl_group*>(objects.ctrl)[g]);
+			const size_type res(visit(details::probe_group(group),
+				g * details::ctrl_group_width));
+
+			if(res != no_slot)
+				return res;
+			assert(step <= mask + 1);
+			g = (g + step) & mask;
+		}
+	}
+	template<typename _tParam>
+	size_type
+	find_slot(const _tParam& k, size_t h) const
+	{
+		if(objects.size == 0)
+			return no_slot;
+
+		const auto& eq(static_cast<const key_equal&>(objects));
+		bool stop(false);
+		const size_type res(probe(h,
+			[&](const details::probe_group& group, size_type base) {
+				for(auto m(group.match(h2(h))); m != 0; m &= m - 1)
+				{
+					const size_type i(base + details::countr_zero(m));
+
+					if(eq(objects.slots[i].first, k))
+						return i;
+				}
+				stop = group.match_empty() != 0;
+				return stop ? size_type(0) : no_slot;
+			}));
+
+		return stop ? no_slot : res;
+	}
+	size_type
+	find_free_slot(size_t h) const
+	{
+		return probe(h, [](const details::probe_group& group, size_type base) {
+			const auto m(group.match_empty_or_deleted());
+
+			return m != 0 ? base + details::countr_zero(m) : no_slot;
+		});
+	}
+	template<typename _tParam, typename... _tParams>
+	size_type
+	emplace_new(size_t h, _tParam&& k, _tParams&&... args)
+	{
+		if(objects.growth_left == 0)
+			rehash(objects.size * 2 >= max_load(objects.capacity)
+					? capacity_for(objects.size + 1)
+					: objects.capacity);
+
+		const size_type i(find_free_slot(h));
+
+		slot_traits::construct(get_slot_allocator(), objects.slots + i,
+			std::piecewise_construct,
+			std::forward_as_tuple(std::forward<_tParam>(k)),
+			std::forward_as_tuple(std::forward<_tParams>(args)...));
+		objects.growth_left -= objects.ctrl[i] == details::ctrl_empty;
+		objects.ctrl[i] = h2(h);
+		++objects.size;
+		return i;
+	}
+	void
+	erase_slot(size_type i) noexcept
+	{
+		slot_traits::destroy(get_slot_allocator(), objects.slots + i);
+		objects.ctrl[i] = details::ctrl_deleted;
+		--objects.size;
+	}
+
+	//! \brief 重新分配 cap 个槽并重新插入所有元素，同时清除删除标记
+	void
+	rehash(size_type cap)
+	{
+		assert(cap >= details::ctrl_group_width && max_load(cap) > size());
+
+		hash_map tmp(get_slot_allocator(), cap);
+
+		static_cast<hasher&>(tmp.objects) = objects;
+		static_cast<key_equal&>(tmp.objects) = objects;
+		for(size_type i(0); i < objects.capacity; ++i)
+			if(objects.ctrl[i] >= 0)
+			{
+				auto& slot(objects.slots[i]);
+				const size_t h(hash_of(slot.first));
+				const size_type j(tmp.find_free_slot(h));
+
+				slot_traits::construct(tmp.get_slot_allocator(),
+					tmp.objects.slots + j, std::move_if_noexcept(slot));
+				tmp.objects.ctrl[j] = h2(h);
+				--tmp.objects.growth_left;
+				++tmp.objects.size;
+			}
+		swap(tmp);
+	}
+	hash_map(const slot_allocator& a, size_type cap)
+		: objects(hasher(), key_equal(), a)
+	{
+		const size_type n(cap / details::ctrl_group_width);
+		group_allocator ga(get_slot_allocator());
+		const auto groups(group_traits::allocate(ga, n + 1));
+
+		objects.ctrl = reinterpret_cast<ctrl_pointer>(groups);
+		std::memset(objects.ctrl, details::ctrl_empty, cap);
+		std::memset(objects.ctrl + cap, details::ctrl_sentinel,
+			details::ctrl_group_width);
+		try
+		{
+			objects.slots = slot_traits::allocate(get_slot_allocator(), cap);
+		}
+		catch(...)
+		{
+			group_traits::deallocate(ga, groups, n + 1);
+			throw;
+		}
+		objects.capacity = cap;
+		objects.growth_left = max_load(cap);
+	}
+
+	void
+	destroy_slots() noexcept
+	{
+		if(objects.size != 0)
+			for(size_type i(0); i < objects.capacity; ++i)
+				if(objects.ctrl[i] >= 0)
+					slot_traits::destroy(
+						get_slot_allocator(), objects.slots + i);
+	}
+	void
+	release_storage() noexcept
+	{
+		if(objects.capacity != 0)
+		{
+			destroy_slots();
+
+			group_allocator ga(get_slot_allocator());
+
+			group_traits::deallocate(ga,
+				reinterpret_cast<details::ctrl_group*>(objects.ctrl),
+				objects.capacity / details::ctrl_group_width + 1);
+			slot_traits::deallocate(
+				get_slot_allocator(), objects.slots, objects.capacity);
+		}
+		reset_storage();
+	}
+	void
+	reset_storage() noexcept
+	{
+		objects.ctrl = {};
+		objects.slots = {};
+		objects.capacity = objects.size = objects.growth_left = 0;
+	}
+};
+
+}
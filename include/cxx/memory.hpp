@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cstring>
+#include <iterator>
+#include "meta.hpp"
+
+namespace cxx
+{
+
+namespace details
+{
+
+/*!
+\brief 未初始化存储上的分配器感知算法
+
+以下算法通过 allocator_traits 构造和销毁元素。构造过程中抛出异常时，
+已经构造的元素会被销毁，目标存储回到调用前的状态。
+对平凡类型且分配器使用默认构造方式时，以 memset 或 memcpy 批量处理。
+*/
+
+template<typename _type>
+struct unwrap_pointer
+{
+	using type = void;
+};
+
+template<typename _type>
+struct unwrap_pointer<_type*>
+{
+	using type = _type;
+};
+
+template<typename _type>
+struct unwrap_pointer<std::move_iterator<_type*>>
+{
+	using type = _type;
+};
+
+template<typename _type>
+_type*
+to_raw(_type* p) noexcept
+{
+	return p;
+}
+template<typename _type>
+_type*
+to_raw(std::move_iterator<_type*> i) noexcept
+{
+	return i.base();
+}
+
+//! \brief 判断是否可以用 memcpy 从源区间复制到目标存储
+template<class _tAlloc, typename _tIn, typename _tOut,
+	typename _tSrc = typename unwrap_pointer<_tIn>::type,
+	typename _tDst = typename unwrap_pointer<_tOut>::type>
+using is_bitwise_copy = and_<is_same<remove_cv_t<_tSrc>, _tDst>,
+	std::is_trivially_copyable<_tDst>,
+	uses_default_construct<_tAlloc, _tDst>>;
+
+//! \brief 判断值初始化是否等价于所有字节置零
+template<class _tAlloc, typename _type>
+using is_zero_value_init
+	= and_<std::is_scalar<_type>, not_<std::is_member_pointer<_type>>,
+		uses_default_construct<_tAlloc, _type>>;
+
+template<class _tAlloc, typename _type>
+using is_bitwise_fill = and_<std::is_trivially_copyable<_type>,
+	uses_default_construct<_tAlloc, _type>>;
+
+
+template<class _tAlloc, typename _tFwd>
+inline void
+destroy_range(_tAlloc&, _tFwd, _tFwd, true_) noexcept
+{}
+template<class _tAlloc, typename _tFwd>
+inline void
+destroy_range(_tAlloc& a, _tFwd first, _tFwd last, false_) noexcept
+{
+	for(; first != last; ++first)
+		allocator_traits<_tAlloc>::destroy(a, std::addressof(*first));
+}
+template<class _tAlloc, typename _tFwd>
+inline void
+destroy_range(_tAlloc& a, _tFwd first, _tFwd last) noexcept
+{
+	using value_type = typename std::iterator_traits<_tFwd>::value_type;
+
+	details::destroy_range(a, first, last,
+		and_<std::is_trivially_destructible<value_type>,
+			uses_default_construct<_tAlloc, value_type>>());
+}
+
+
+template<class _tAlloc, typename _tIn, typename _tFwd>
+inline _tFwd
+uninitialized_copy(_tAlloc&, _tIn first, _tIn last, _tFwd result, true_)
+{
+	const auto n(std::distance(first, last));
+
+	if(n != 0)
+		std::memcpy(static_cast<void*>(result), to_raw(first),
+			n * sizeof(*result));
+	return result + n;
+}
+template<class _tAlloc, typename _tIn, typename _tFwd>
+_tFwd
+uninitialized_copy(_tAlloc& a, _tIn first, _tIn last, _tFwd result, false_)
+{
+	auto current(result);
+
+	try
+	{
+		for(; first != last; ++first, static_cast<void>(++current))
+			allocator_traits<_tAlloc>::construct(
+				a, std::addressof(*current), *first);
+		return current;
+	}
+	catch(...)
+	{
+		details::destroy_range(a, result, current);
+		throw;
+	}
+}
+//! \brief 复制构造区间到未初始化存储
+template<class _tAlloc, typename _tIn, typename _tFwd>
+inline _tFwd
+uninitialized_copy(_tAlloc& a, _tIn first, _tIn last, _tFwd result)
+{
+	return details::uninitialized_copy(
+		a, first, last, result, is_bitwise_copy<_tAlloc, _tIn, _tFwd>());
+}
+
+//! \brief 移动构造区间到未初始化存储
+template<class _tAlloc, typename _tIn, typename _tFwd>
+inline _tFwd
+uninitialized_move(_tAlloc& a, _tIn first, _tIn last, _tFwd result)
+{
+	return details::uninitialized_copy(a, std::make_move_iterator(first),
+		std::make_move_iterator(last), result);
+}
+
+template<class _tAlloc, typename _type>
+inline _type*
+uninitialized_move_if_noexcept(
+	_tAlloc& a, _type* first, _type* last, _type* result, true_)
+{
+	return details::uninitialized_move(a, first, last, result);
+}
+template<class _tAlloc, typename _type>
+inline _type*
+uninitialized_move_if_noexcept(
+	_tAlloc& a, _type* first, _type* last, _type* result, false_)
+{
+	return details::uninitialized_copy(a, first, last, result);
+}
+/*!
+\brief 移动构造区间到未初始化存储，移动可能抛出异常时复制
+\note 和 std::move_if_noexcept 相同，不可复制的类型总是移动。
+*/
+template<class _tAlloc, typename _type>
+inline _type*
+uninitialized_move_if_noexcept(
+	_tAlloc& a, _type* first, _type* last, _type* result)
+{
+	return details::uninitialized_move_if_noexcept(a, first, last, result,
+		or_<std::is_nothrow_move_constructible<_type>,
+			not_<std::is_copy_constructible<_type>>>());
+}
+
+
+template<class _tAlloc, typename _tFwd, typename _tSize, typename _type>
+inline _tFwd
+uninitialized_fill_n(_tAlloc&, _tFwd first, _tSize n, const _type& val, true_)
+{
+	if(sizeof(_type) == 1)
+	{
+		if(n != 0)
+		{
+			unsigned char byte;
+
+			std::memcpy(&byte, std::addressof(val), 1);
+			std::memset(static_cast<void*>(first), byte, size_t(n));
+		}
+		return first + n;
+	}
+	return std::fill_n(first, n, val);
+}
+template<class _tAlloc, typename _tFwd, typename _tSize, typename _type>
+_tFwd
+uninitialized_fill_n(
+	_tAlloc& a, _tFwd first, _tSize n, const _type& val, false_)
+{
+	auto current(first);
+
+	try
+	{
+		for(; n > 0; --n, static_cast<void>(++current))
+			allocator_traits<_tAlloc>::construct(
+				a, std::addressof(*current), val);
+		return current;
+	}
+	catch(...)
+	{
+		details::destroy_range(a, first, current);
+		throw;
+	}
+}
+//! \brief 以给定值复制构造 n 个元素
+template<class _tAlloc, typename _tFwd, typename _tSize, typename _type>
+inline _tFwd
+uninitialized_fill_n(_tAlloc& a, _tFwd first, _tSize n, const _type& val)
+{
+	return details::uninitialized_fill_n(a, first, n, val,
+		and_<is_same<_tFwd, _type*>, is_bitwise_fill<_tAlloc, _type>>());
+}
+
+
+template<class _tAlloc, typename _tFwd, typename _tSize>
+inline _tFwd
+uninitialized_value_construct_n(_tAlloc&, _tFwd first, _tSize n, true_)
+{
+	if(n != 0)
+		std::memset(static_cast<void*>(first), 0, n * sizeof(*first));
+	return first + n;
+}
+template<class _tAlloc, typename _tFwd, typename _tSize>
+_tFwd
+uninitialized_value_construct_n(_tAlloc& a, _tFwd first, _tSize n, false_)
+{
+	auto current(first);
+
+	try
+	{
+		for(; n > 0; --n, static_cast<void>(++current))
+			allocator_traits<_tAlloc>::construct(a, std::addressof(*current));
+		return current;
+	}
+	catch(...)
+	{
+		details::destroy_range(a, first, current);
+		throw;
+	}
+}
+//! \brief 值初始化 n 个元素
+template<class _tAlloc, typename _tFwd, typename _tSize>
+inline _tFwd
+uninitialized_value_construct_n(_tAlloc& a, _tFwd first, _tSize n)
+{
+	using value_type = typename std::iterator_traits<_tFwd>::value_type;
+
+	return details::uninitialized_value_construct_n(a, first, n,
+		and_<is_same<_tFwd, value_type*>,
+			is_zero_value_init<_tAlloc, value_type>>());
+}
+
+
+template<class _tAlloc, typename _type>
+inline _type*
+uninitialized_relocate(_tAlloc&, _type* first, _type* last, _type* result,
+	true_) noexcept
+{
+	const auto n(last - first);
+
+	if(n != 0)
+		std::memmove(static_cast<void*>(result), static_cast<void*>(first),
+			n * sizeof(_type));
+	return result + n;
+}
+template<class _tAlloc, typename _type>
+_type*
+uninitialized_relocate(
+	_tAlloc& a, _type* first, _type* last, _type* result, false_)
+{
+	auto current(result);
+
+	try
+	{
+		for(auto i(first); i != last; ++i, static_cast<void>(++current))
+			allocator_traits<_tAlloc>::construct(
+				a, current, std::move_if_noexcept(*i));
+	}
+	catch(...)
+	{
+		details::destroy_range(a, result, current);
+		throw;
+	}
+	details::destroy_range(a, first, last);
+	return current;
+}
+/*!
+\brief 把区间中的元素重定位到不重叠的未初始化存储
+\note 移动构造可能抛出异常时复制元素，抛出异常时源区间保持不变。
+\note 可平凡重定位的元素使用 memmove 整体移动。
+*/
+template<class _tAlloc, typename _type>
+inline _type*
+uninitialized_relocate(_tAlloc& a, _type* first, _type* last, _type* result)
+{
+	return details::uninitialized_relocate(a, first, last, result,
+		and_<is_trivially_relocatable<_type>,
+			uses_default_construct<_tAlloc, _type>>());
+}
+
+} // namespace details;
+
+}
@@ -51,6 +51,19 @@ struct or_<_b1, _b2, _bn...>
 	: std::conditional<_b1::value, _b1, or_<_b2, _bn...>>::type
 {};
 
+template<class _b>
+struct not_ : bool_<!_b::value>
+{};
+
+template<typename...>
+struct make_void
+{
+	using type = void;
+};
+
+template<typename... _types>
+using void_t = typename make_void<_types...>::type;
+
 template<typename _type>
 using indirect_t = decltype(*std::declval<_type>());
 
@@ -91,4 +104,112 @@ using rebind_alloc_t =
 template<typename _type, typename _tValue>
 using is_allocator_for = is_same<typename _type::value_type, _tValue>;
 
+/*!
+\brief 判断类型是否可平凡重定位
+\note 可平凡重定位类型的对象可以逐字节复制到新存储后直接丢弃原对象，
+	不需要调用构造函数和析构函数。
+\note 默认为可平凡复制的类型；用户可以对其它类型特化此模板。
+*/
+template<typename _type>
+struct is_trivially_relocatable : std::is_trivially_copyable<_type>
+{};
+
+namespace details
+{
+
+template<class _tAlloc, typename _type, typename = void>
+struct has_mem_construct : false_
+{};
+
+template<class _tAlloc, typename _type>
+struct has_mem_construct<_tAlloc, _type,
+	void_t<decltype(std::declval<_tAlloc&>().construct(
+		std::declval<_type*>(), std::declval<_type&&>()))>> : true_
+{};
+
+template<class _tAlloc, typename _type, typename = void>
+struct has_mem_destroy : false_
+{};
+
+template<class _tAlloc, typename _type>
+struct has_mem_destroy<_tAlloc, _type,
+	void_t<decltype(std::declval<_tAlloc&>().destroy(
+		std::declval<_type*>()))>> : true_
+{};
+
+} // namespace details;
+
+template<class _tAlloc>
+struct is_std_allocator : false_
+{};
+
+template<typename _type>
+struct is_std_allocator<std::allocator<_type>> : true_
+{};
+
+/*!
+\brief 判断分配器是否使用默认的构造和析构方式
+\note 满足时容器可以绕过分配器直接按字节操作元素存储。
+*/
+template<class _tAlloc, typename _type>
+struct uses_default_construct
+	: or_<is_std_allocator<_tAlloc>,
+		  and_<not_<details::has_mem_construct<_tAlloc, _type>>,
+			  not_<details::has_mem_destroy<_tAlloc, _type>>>>
+{};
+
+/*!
+\brief 容器统计的钩子
+\note 分配器有返回统计记录的成员函数 get_stats() 时，容器把分配器看不到的事件
+	（显式 reserve 、增长、元素的移动和释放存储时的大小）报告给记录的同名成员；
+	否则所有调用都是空操作，不带来开销。参见 container_stats.hpp 。
+*/
+template<class _tAlloc, typename = void>
+struct container_hook
+{
+	static void
+	reserve_call(const _tAlloc&, size_t, size_t) noexcept
+	{}
+	static void
+	grow(const _tAlloc&, size_t, size_t, size_t, size_t) noexcept
+	{}
+	static void
+	shift(const _tAlloc&, size_t, size_t) noexcept
+	{}
+	static void
+	release(const _tAlloc&, size_t, size_t, size_t) noexcept
+	{}
+};
+
+template<class _tAlloc>
+struct container_hook<_tAlloc,
+	void_t<decltype(std::declval<const _tAlloc&>().get_stats())>>
+{
+	//! \brief 显式请求 n 个元素的容量，当前容量为 cap
+	static void
+	reserve_call(const _tAlloc& a, size_t n, size_t cap) noexcept
+	{
+		a.get_stats().reserve_call(n, cap);
+	}
+	//! \brief 容量从 old_cap 增长到 new_cap ，重定位了 moved 个元素
+	static void
+	grow(const _tAlloc& a, size_t old_cap, size_t new_cap, size_t moved,
+		size_t obj_size) noexcept
+	{
+		a.get_stats().grow(old_cap, new_cap, moved, obj_size);
+	}
+	//! \brief 插入或擦除时在存储中移动了 moved 个元素
+	static void
+	shift(const _tAlloc& a, size_t moved, size_t obj_size) noexcept
+	{
+		a.get_stats().shift(moved, obj_size);
+	}
+	//! \brief 释放容量为 cap 、有 n 个元素的存储
+	static void
+	release(const _tAlloc& a, size_t n, size_t cap, size_t obj_size) noexcept
+	{
+		a.get_stats().release(n, cap, obj_size);
+	}
+};
+
 }
\ No newline at end of file
@@ -0,0 +1,507 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include "thread_pool.hpp"
+
+namespace cxx
+{
+
+/*!
+\brief 并行算法
+\note 算法把连续的随机访问迭代器区间（例如 vector 和 array 的）分成块，
+	由调用线程和线程池的工作线程领取执行。传入的函数对象会被多个线程同时调用。
+\note 可以在线程池的任务中调用，等待时调用线程执行其它任务。
+\note 第一个抛出的异常在所有线程结束后重新抛出，此时输出区间的内容未指定。
+*/
+namespace parallel
+{
+
+//! \brief 并行算法的选项
+struct options
+{
+	//! \brief 参与计算的线程数（含调用线程），为 0 时取线程池的线程数加 1
+	unsigned threads = 0;
+	//! \brief 每块的元素数，为 0 时按元素数自动选择
+	size_t grain = 0;
+	/*!
+	\brief 确定的归约顺序
+	\note 为 true 时块的划分只由元素数和 grain 决定，各块的结果按块的顺序合并，
+		浮点数的结果和线程数及调度无关；否则每个线程先合并自己领取的块，
+		归约操作需要满足交换律。
+	*/
+	bool deterministic = false;
+	//! \brief 执行任务的线程池，为空时使用 thread_pool::shared()
+	thread_pool* pool = nullptr;
+};
+
+//! \brief 默认选项
+constexpr options par{};
+
+namespace details
+{
+
+//! \brief 自动选择时每块的最少元素数
+constexpr size_t min_grain = 1024;
+//! \brief 自动选择时确定的划分使用的块数
+constexpr size_t default_chunks = 256;
+
+//! \brief 区间的划分：块 i 为 [i * grain, min((i + 1) * grain, size))
+struct partition
+{
+	size_t size;
+	size_t grain;
+	size_t chunks;
+	unsigned workers;
+
+	size_t
+	begin(size_t i) const noexcept
+	{
+		return i * grain;
+	}
+	size_t
+	end(size_t i) const noexcept
+	{
+		return std::min(size, (i + 1) * grain);
+	}
+};
+
+inline thread_pool&
+pool_of(const options& opts)
+{
+	return opts.pool ? *opts.pool : thread_pool::shared();
+}
+
+inline unsigned
+thread_count(const options& opts)
+{
+	return opts.threads != 0 ? opts.threads : pool_of(opts).size() + 1;
+}
+
+inline partition
+make_partition(const options& opts, size_t n)
+{
+	const unsigned threads(thread_count(opts));
+	size_t grain(opts.grain);
+
+	if(grain == 0)
+	{
+		// a few chunks per thread balance the load; the deterministic
+		// partition must not depend on the number of threads
+		const size_t target(opts.deterministic
+				? default_chunks
+				: std::max(default_chunks, size_t(threads) * 4));
+
+		grain = std::max(min_grain, (n + target - 1) / target);
+	}
+
+	const size_t chunks((n + grain - 1) / grain);
+
+	return {n, grain, chunks, unsigned(std::min<size_t>(threads, chunks))};
+}
+
+//! \brief 在线程池上执行，参见 thread_pool::run_chunks
+template<class _fWork>
+void
+run_chunks(const options& opts, size_t chunks, unsigned workers, _fWork work)
+{
+	pool_of(opts).run_chunks(chunks, workers, std::move(work));
+}
+
+template<typename _tRan>
+using require_random_access = enable_if_t<std::is_base_of<
+	std::random_access_iterator_tag,
+	typename std::iterator_traits<_tRan>::iterator_category>::value>;
+
+/*!
+\brief 按划分并行归约
+\param chunk_value 计算块 [b, e) 的归约结果， b < e
+*/
+template<typename _type, class _fReduce, class _fChunk>
+_type
+reduce_chunks(
+	const options& opts, size_t n, _type init, _fReduce op, _fChunk chunk_value)
+{
+	const partition part(make_partition(opts, n));
+
+	if(part.workers <= 1 && !opts.deterministic)
+		return n == 0 ? init : op(std::move(init), chunk_value(size_t(0), n));
+	if(opts.deterministic)
+	{
+		vector<_type> partials(part.chunks, init);
+
+		run_chunks(opts, part.chunks, part.workers, [&](size_t i, unsigned) {
+			partials[i] = chunk_value(part.begin(i), part.end(i));
+		});
+		for(auto& x : partials)
+			init = op(std::move(init), std::move(x));
+		return init;
+	}
+
+	vector<_type> partials(part.workers, init);
+	vector<unsigned char> used(part.workers);
+
+	run_chunks(opts, part.chunks, part.workers, [&](size_t i, unsigned w) {
+		if(used[w])
+			partials[w] = op(std::move(partials[w]),
+				chunk_value(part.begin(i), part.end(i)));
+		else
+		{
+			partials[w] = chunk_value(part.begin(i), part.end(i));
+			used[w] = 1;
+		}
+	});
+	for(unsigned w(0); w != part.workers; ++w)
+		if(used[w])
+			init = op(std::move(init), std::move(partials[w]));
+	return init;
+}
+
+/*!
+\brief 合并路径：a 和 b 合并后的前 d 个元素中来自 a 的个数
+\note 相等的元素先取 a 中的，和 std::merge 相同。
+*/
+template<typename _tRan, class _fComp>
+size_t
+merge_path(_tRan a, size_t na, _tRan b, size_t nb, size_t d, _fComp& comp)
+{
+	size_t lo(d > nb ? d - nb : 0), hi(std::min(d, na));
+
+	while(lo < hi)
+	{
+		const size_t mid(lo + (hi - lo) / 2);
+
+		if(!comp(b[d - mid - 1], a[mid]))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*!
+\brief 把 src 中相邻的有序段两两合并到 dst
+\param runs 段数，为偶数；段 r 为 [bound(r), bound(r + 1))
+\note 每次合并按合并路径分成若干份，所有份一起由线程领取。
+	所有份的分割点在移动任何元素之前求出，因为查找会读取相邻的份中的元素。
+*/
+template<typename _tSrc, typename _tDst, class _fBound, class _fComp>
+void
+merge_level(const options& opts, _tSrc src, _tDst dst, size_t runs,
+	_fBound bound, size_t piece, unsigned workers, _fComp& comp)
+{
+	// pieces of merge m are [first_piece[m], first_piece[m + 1])
+	vector<size_t> first_piece(runs / 2 + 1);
+
+	for(size_t m(0); m != runs / 2; ++m)
+		first_piece[m + 1] = first_piece[m]
+			+ (bound(m * 2 + 2) - bound(m * 2) + piece - 1) / piece;
+
+	const size_t pieces(first_piece.back());
+	const auto locate([&](size_t i) {
+		return size_t(
+			std::upper_bound(first_piece.begin(), first_piece.end(), i)
+			- first_piece.begin() - 1);
+	});
+	// elements taken from the first run before each piece
+	vector<size_t> splits(pieces);
+
+	workers = unsigned(std::min<size_t>(workers, pieces));
+	run_chunks(opts, pieces, workers, [&](size_t i, unsigned) {
+		const size_t m(locate(i));
+		const size_t base(bound(m * 2)), mid(bound(m * 2 + 1));
+
+		splits[i] = merge_path(src + base, mid - base, src + mid,
+			bound(m * 2 + 2) - mid, (i - first_piece[m]) * piece, comp);
+	});
+	run_chunks(opts, pieces, workers, [&](size_t i, unsigned) {
+		const size_t m(locate(i));
+		const size_t base(bound(m * 2)), mid(bound(m * 2 + 1)),
+			last(bound(m * 2 + 2));
+		const size_t lo((i - first_piece[m]) * piece),
+			hi(std::min(last - base, lo + piece));
+		const size_t ia(splits[i]),
+			ib(i + 1 != first_piece[m + 1] ? splits[i + 1] : mid - base);
+		const auto a(src + base), b(src + mid);
+
+		std::merge(std::make_move_iterator(a + ia),
+			std::make_move_iterator(a + ib),
+			std::make_move_iterator(b + (lo - ia)),
+			std::make_move_iterator(b + (hi - ib)), dst + base + lo, comp);
+	});
+}
+
+} // namespace details;
+
+//! \brief 对每个元素调用 f
+template<typename _tRan, class _fUnary,
+	typename = details::require_random_access<_tRan>>
+void
+for_each(const options& opts, _tRan first, _tRan last, _fUnary f)
+{
+	const auto part(details::make_partition(opts, size_t(last - first)));
+
+	details::run_chunks(
+		opts, part.chunks, part.workers, [&](size_t i, unsigned) {
+			std::for_each(first + part.begin(i), first + part.end(i), f);
+		});
+}
+
+//! \return 输出区间的末尾
+template<typename _tRan, typename _tOut, class _fUnary,
+	typename = details::require_random_access<_tRan>>
+_tOut
+transform(
+	const options& opts, _tRan first, _tRan last, _tOut result, _fUnary op)
+{
+	const auto part(details::make_partition(opts, size_t(last - first)));
+
+	details::run_chunks(
+		opts, part.chunks, part.workers, [&](size_t i, unsigned) {
+			std::transform(first + part.begin(i), first + part.end(i),
+				result + part.begin(i), op);
+		});
+	return result + part.size;
+}
+template<typename _tRan1, typename _tRan2, typename _tOut, class _fBinary,
+	typename = details::require_random_access<_tRan1>>
+_tOut
+transform(const options& opts, _tRan1 first1, _tRan1 last1, _tRan2 first2,
+	_tOut result, _fBinary op)
+{
+	const auto part(details::make_partition(opts, size_t(last1 - first1)));
+
+	details::run_chunks(
+		opts, part.chunks, part.workers, [&](size_t i, unsigned) {
+			std::transform(first1 + part.begin(i), first1 + part.end(i),
+				first2 + part.begin(i), result + part.begin(i), op);
+		});
+	return result + part.size;
+}
+
+/*!
+\brief 对每个元素变换后归约
+\note reduce_op 需要满足结合律；不要求确定的顺序时还需要满足交换律。
+*/
+template<typename _tRan, typename _type, class _fReduce, class _fTransform,
+	typename = details::require_random_access<_tRan>>
+_type
+transform_reduce(const options& opts, _tRan first, _tRan last, _type init,
+	_fReduce reduce_op, _fTransform transform_op)
+{
+	return details::reduce_chunks(opts, size_t(last - first), std::move(init),
+		reduce_op, [&](size_t b, size_t e) {
+			_type acc(transform_op(first[b]));
+
+			while(++b != e)
+				acc = reduce_op(std::move(acc), transform_op(first[b]));
+			return acc;
+		});
+}
+//! \brief 对两个区间对应的元素变换后归约
+template<typename _tRan1, typename _tRan2, typename _type, class _fReduce,
+	class _fTransform, typename = details::require_random_access<_tRan1>>
+_type
+transform_reduce(const options& opts, _tRan1 first1, _tRan1 last1,
+	_tRan2 first2, _type init, _fReduce reduce_op, _fTransform transform_op)
+{
+	return details::reduce_chunks(opts, size_t(last1 - first1),
+		std::move(init), reduce_op, [&](size_t b, size_t e) {
+			_type acc(transform_op(first1[b], first2[b]));
+
+			while(++b != e)
+				acc = reduce_op(
+					std::move(acc), transform_op(first1[b], first2[b]));
+			return acc;
+		});
+}
+//! \brief 内积
+template<typename _tRan1, typename _tRan2, typename _type,
+	typename = details::require_random_access<_tRan1>>
+_type
+transform_reduce(const options& opts, _tRan1 first1, _tRan1 last1,
+	_tRan2 first2, _type init)
+{
+	return parallel::transform_reduce(opts, first1, last1, first2,
+		std::move(init), std::plus<>(), std::multiplies<>());
+}
+
+//! \note op 的要求同 transform_reduce 的 reduce_op 。
+template<typename _tRan, typename _type, class _fReduce,
+	typename = details::require_random_access<_tRan>>
+_type
+reduce(
+	const options& opts, _tRan first, _tRan last, _type init, _fReduce op)
+{
+	return details::reduce_chunks(opts, size_t(last - first), std::move(init),
+		op, [&](size_t b, size_t e) {
+			_type acc(first[b]);
+
+			while(++b != e)
+				acc = op(std::move(acc), first[b]);
+			return acc;
+		});
+}
+template<typename _tRan, typename _type,
+	typename = details::require_random_access<_tRan>>
+_type
+reduce(const options& opts, _tRan first, _tRan last, _type init)
+{
+	return parallel::reduce(opts, first, last, std::move(init), std::plus<>());
+}
+template<typename _tRan, typename = details::require_random_access<_tRan>>
+typename std::iterator_traits<_tRan>::value_type
+reduce(const options& opts, _tRan first, _tRan last)
+{
+	return parallel::reduce(opts, first, last,
+		typename std::iterator_traits<_tRan>::value_type());
+}
+
+/*!
+\brief 并行归并排序
+\note 元素先移动到缓冲区中分段排序，再按合并路径并行地逐层两两合并，
+	段数取不小于线程数的 2 的幂，但每段至少有 grain 个元素。
+\note 和 std::sort 一样不是稳定的。
+*/
+template<typename _tRan, class _fComp = std::less<>,
+	typename = details::require_random_access<_tRan>>
+void
+sort(const options& opts, _tRan first, _tRan last, _fComp comp = _fComp())
+{
+	using value_type = typename std::iterator_traits<_tRan>::value_type;
+	const size_t n(size_t(last - first));
+	const unsigned threads(details::thread_count(opts));
+	const size_t min_run(opts.grain != 0 ? opts.grain : details::min_grain);
+	size_t runs(1);
+
+	while(runs < threads && n / (runs * 2) >= min_run)
+		runs *= 2;
+	if(runs == 1)
+	{
+		std::sort(first, last, comp);
+		return;
+	}
+
+	vector<value_type> buffer(
+		std::make_move_iterator(first), std::make_move_iterator(last));
+	const auto buf(buffer.begin());
+	const unsigned workers(unsigned(std::min<size_t>(threads, runs)));
+	const size_t piece(
+		std::max<size_t>(min_run / 2 + 1, n / (size_t(threads) * 4)));
+	size_t width(1);
+	bool in_buffer(true);
+
+	details::run_chunks(opts, runs, workers, [&](size_t r, unsigned) {
+		std::sort(buf + n * r / runs, buf + n * (r + 1) / runs, comp);
+	});
+	for(; width != runs; width *= 2, in_buffer = !in_buffer)
+	{
+		const auto bound([&](size_t r) { return n * (r * width) / runs; });
+
+		if(in_buffer)
+			details::merge_level(
+				opts, buf, first, runs / width, bound, piece, threads, comp);
+		else
+			details::merge_level(
+				opts, first, buf, runs / width, bound, piece, threads, comp);
+	}
+	if(in_buffer)
+	{
+		const auto part(details::make_partition(opts, n));
+
+		details::run_chunks(
+			opts, part.chunks, part.workers, [&](size_t i, unsigned) {
+				std::move(buf + part.begin(i), buf + part.end(i),
+					first + part.begin(i));
+			});
+	}
+}
+
+namespace details
+{
+
+/*!
+\brief 两遍的并行前缀和：先归约每块，再从前面所有块的和开始扫描每块
+\param init 为空时第一个元素的前缀和就是它本身
+*/
+template<typename _tRan, typename _tOut, class _fBinary, typename _type>
+_tOut
+scan_chunks(const options& opts, _tRan first, _tRan last, _tOut result,
+	_fBinary op, const _type* init)
+{
+	const auto part(make_partition(opts, size_t(last - first)));
+	const auto scan([&](size_t b, size_t e, const _type* prefix) {
+		_type acc(prefix ? op(*prefix, first[b]) : _type(first[b]));
+
+		result[b] = acc;
+		while(++b != e)
+		{
+			acc = op(std::move(acc), first[b]);
+			result[b] = acc;
+		}
+	});
+
+	if(part.chunks == 0)
+		return result;
+	if(part.workers <= 1)
+	{
+		scan(size_t(0), part.size, init);
+		return result + part.size;
+	}
+
+	// prefixes[i] is the sum of everything before chunk i
+	vector<_type> prefixes(part.chunks, _type(first[0]));
+
+	run_chunks(opts, part.chunks - 1, part.workers, [&](size_t i, unsigned) {
+		size_t b(part.begin(i));
+		_type acc(first[b]);
+
+		while(++b != part.end(i))
+			acc = op(std::move(acc), first[b]);
+		prefixes[i + 1] = std::move(acc);
+	});
+	if(init)
+		prefixes[0] = *init;
+	for(size_t i(1); i != part.chunks; ++i)
+		if(i != 1 || init)
+			prefixes[i] = op(prefixes[i - 1], std::move(prefixes[i]));
+	run_chunks(opts, part.chunks, part.workers, [&](size_t i, unsigned) {
+		scan(part.begin(i), part.end(i),
+			i != 0 || init ? &prefixes[i] : nullptr);
+	});
+	return result + part.size;
+}
+
+} // namespace details;
+
+/*!
+\brief 包含当前元素的前缀和
+\return 输出区间的末尾
+\note op 需要满足结合律，浮点数的结果可能和顺序计算的不同，但在
+	划分确定时是确定的。 result 可以等于 first 。
+*/
+template<typename _tRan, typename _tOut, class _fBinary = std::plus<>,
+	typename = details::require_random_access<_tRan>>
+_tOut
+inclusive_scan(const options& opts, _tRan first, _tRan last, _tOut result,
+	_fBinary op = _fBinary())
+{
+	using value_type = typename std::iterator_traits<_tRan>::value_type;
+
+	return details::scan_chunks<_tRan, _tOut, _fBinary, value_type>(
+		opts, first, last, result, op, nullptr);
+}
+//! \brief 从 init 开始的前缀和
+template<typename _tRan, typename _tOut, class _fBinary, typename _type,
+	typename = details::require_random_access<_tRan>>
+_tOut
+inclusive_scan(const options& opts, _tRan first, _tRan last, _tOut result,
+	_fBinary op, _type init)
+{
+	return details::scan_chunks(opts, first, last, result, op, &init);
+}
+
+} // namespace parallel;
+
+}
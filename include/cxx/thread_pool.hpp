@@ -0,0 +1,765 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "vector.hpp"
+#if defined(__linux__)
+#	include <pthread.h>
+#	include <sched.h>
+#endif
+
+namespace cxx
+{
+
+namespace details
+{
+
+//! \brief 线程池调度的任务，由 execute 负责任务对象的生存期
+struct pool_task
+{
+	void (*execute)(pool_task*) noexcept;
+};
+
+//! \brief 避免伪共享的缓存行大小
+constexpr size_t cache_line = 64;
+
+/*!
+\brief Chase-Lev 工作窃取双端队列
+\note 所有者在底部压入和弹出，其它线程从顶部窃取；都是无锁的。
+\note 环形缓冲区满时加倍；旧的缓冲区可能仍被窃取者读取，
+	保留到队列析构时才释放。
+\see D. Chase, Y. Lev. Dynamic Circular Work-Stealing Deque. SPAA 2005.
+\see N. M. Lê et al. Correct and Efficient Work-Stealing for Weak Memory
+	Models. PPoPP 2013.
+*/
+class work_deque
+{
+private:
+	struct ring
+	{
+		int64_t mask;
+		std::unique_ptr<std::atomic<pool_task*>[]> slots;
+		std::unique_ptr<ring> previous;
+
+		explicit ring(int64_t capacity)
+			: mask(capacity - 1),
+			  slots(new std::atomic<pool_task*>[size_t(capacity)])
+		{}
+
+		pool_task*
+		get(int64_t i) const noexcept
+		{
+			return slots[size_t(i & mask)].load(std::memory_order_relaxed);
+		}
+		void
+		put(int64_t i, pool_task* t) noexcept
+		{
+			slots[size_t(i & mask)].store(t, std::memory_order_relaxed);
+		}
+	};
+
+	// top is written by thieves and bottom by the owner; the padding keeps
+	// them on separate cache lines without over-aligning the deque, which
+	// operator new does not support before C++17
+	std::atomic<int64_t> top{0};
+	char top_padding[cache_line];
+	std::atomic<int64_t> bottom{0};
+	char bottom_padding[cache_line];
+	std::atomic<ring*> buffer;
+	std::unique_ptr<ring> storage;
+
+public:
+	explicit work_deque(int64_t capacity = 256)
+		: storage(new ring(capacity))
+	{
+		buffer.store(storage.get(), std::memory_order_relaxed);
+	}
+	work_deque(const work_deque&) = delete;
+
+	work_deque&
+	operator=(const work_deque&)
+		= delete;
+
+	//! \note 只由所有者调用。
+	void
+	push(pool_task* t)
+	{
+		const int64_t b(bottom.load(std::memory_order_relaxed));
+		const int64_t t0(top.load(std::memory_order_acquire));
+		ring* a(buffer.load(std::memory_order_relaxed));
+
+		if(b - t0 > a->mask)
+			a = grow(a, t0, b);
+		a->put(b, t);
+		bottom.store(b + 1, std::memory_order_release);
+	}
+	//! \note 只由所有者调用。队列为空时返回空指针。
+	pool_task*
+	pop() noexcept
+	{
+		const int64_t b(bottom.load(std::memory_order_relaxed) - 1);
+		ring* const a(buffer.load(std::memory_order_relaxed));
+
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		int64_t t(top.load(std::memory_order_relaxed));
+
+		if(t > b)
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return {};
+		}
+
+		pool_task* x(a->get(b));
+
+		if(t == b)
+		{
+			// the last task: race the thieves for it
+			if(!top.compare_exchange_strong(t, t + 1,
+				   std::memory_order_seq_cst, std::memory_order_relaxed))
+				x = {};
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return x;
+	}
+	/*!
+	\brief 从顶部窃取
+	\return 队列为空或和其它线程竞争失败时返回空指针
+	*/
+	pool_task*
+	steal() noexcept
+	{
+		int64_t t(top.load(std::memory_order_acquire));
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		const int64_t b(bottom.load(std::memory_order_acquire));
+
+		if(t >= b)
+			return {};
+
+		pool_task* const x(buffer.load(std::memory_order_acquire)->get(t));
+
+		return top.compare_exchange_strong(t, t + 1,
+				   std::memory_order_seq_cst, std::memory_order_relaxed)
+			? x
+			: nullptr;
+	}
+	bool
+	empty() const noexcept
+	{
+		return top.load(std::memory_order_acquire)
+			>= bottom.load(std::memory_order_acquire);
+	}
+
+private:
+	ring*
+	grow(ring* a, int64_t t, int64_t b)
+	{
+		std::unique_ptr<ring> bigger(new ring((a->mask + 1) * 2));
+
+		for(int64_t i(t); i != b; ++i)
+			bigger->put(i, a->get(i));
+		bigger->previous = std::move(storage);
+		storage = std::move(bigger);
+		buffer.store(storage.get(), std::memory_order_release);
+		return storage.get();
+	}
+};
+
+//! \brief 自旋、让出，之后由调用者阻塞的退避
+class backoff
+{
+private:
+	unsigned rounds = 0;
+
+public:
+	//! \return 为 false 时应当阻塞等待
+	bool
+	pause() noexcept
+	{
+		if(rounds < 64)
+		{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+			__builtin_ia32_pause();
+#endif
+			++rounds;
+			return true;
+		}
+		if(rounds < 80)
+		{
+			std::this_thread::yield();
+			++rounds;
+			return true;
+		}
+		return false;
+	}
+	void
+	reset() noexcept
+	{
+		rounds = 0;
+	}
+};
+
+//! \brief 分叉-合并的汇合点：最后一个完成的任务唤醒等待者
+class join_state
+{
+private:
+	std::atomic<size_t> pending;
+	std::exception_ptr failure;
+	std::mutex mtx;
+	std::condition_variable cv;
+
+public:
+	explicit join_state(size_t n) noexcept : pending(n)
+	{}
+
+	bool
+	done() const noexcept
+	{
+		return pending.load(std::memory_order_acquire) == 0;
+	}
+	//! \brief 记录第一个异常
+	void
+	fail(std::exception_ptr e) noexcept
+	{
+		std::lock_guard<std::mutex> lck(mtx);
+
+		if(!failure)
+			failure = std::move(e);
+	}
+	void
+	finish() noexcept
+	{
+		// decrement under the lock so that the waiter cannot return and
+		// destroy this object while it is still being notified
+		std::lock_guard<std::mutex> lck(mtx);
+
+		if(pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			cv.notify_all();
+	}
+	void
+	block() noexcept
+	{
+		std::unique_lock<std::mutex> lck(mtx);
+
+		cv.wait_for(
+			lck, std::chrono::milliseconds(1), [this] { return done(); });
+	}
+	//! \brief 等待最后完成的任务释放锁，之后本对象可以销毁
+	void
+	settle() noexcept
+	{
+		std::lock_guard<std::mutex> lck(mtx);
+	}
+	//! \pre done()
+	void
+	rethrow()
+	{
+		std::lock_guard<std::mutex> lck(mtx);
+
+		if(failure)
+			std::rethrow_exception(failure);
+	}
+};
+
+} // namespace details;
+
+/*!
+\brief 工作窃取线程池
+\note 每个工作线程有自己的 Chase-Lev 双端队列。工作线程提交的任务压入自己的
+	队列底部并优先执行（后进先出），空闲时从其它队列的顶部窃取；
+	其它线程提交的任务进入带锁的注入队列。
+\note 等待分叉-合并的子任务时调用者也执行任务，因此可以在任务中嵌套使用
+	parallel_invoke 和 run_chunks 而不会死锁。
+\note 空闲的线程先自旋，再让出，最后在条件变量上休眠，有新任务时被唤醒。
+\note 析构时执行完所有已提交的任务后结束工作线程。
+*/
+class thread_pool
+{
+private:
+	struct worker
+	{
+		details::work_deque tasks;
+		std::thread thread;
+	};
+	struct context
+	{
+		thread_pool* pool;
+		unsigned index;
+	};
+
+	template<class _fCallable>
+	struct heap_task : details::pool_task
+	{
+		_fCallable callable;
+
+		explicit heap_task(_fCallable&& f)
+			: details::pool_task{run}, callable(std::move(f))
+		{}
+
+		static void
+		run(details::pool_task* p) noexcept
+		{
+			std::unique_ptr<heap_task> t(static_cast<heap_task*>(p));
+
+			t->callable();
+		}
+	};
+
+	// 由等待者拥有的子任务，引用等待者的函数对象
+	struct join_task : details::pool_task
+	{
+		void (*call)(void*);
+		void* callable;
+		details::join_state* state;
+
+		template<class _fCallable>
+		join_task(_fCallable& f, details::join_state& s) noexcept
+			: details::pool_task{run},
+			  call([](void* q) { (*static_cast<_fCallable*>(q))(); }),
+			  callable(const_cast<void*>(
+				  static_cast<const void*>(std::addressof(f)))),
+			  state(std::addressof(s))
+		{}
+
+		static void
+		run(details::pool_task* p) noexcept
+		{
+			const auto t(static_cast<join_task*>(p));
+
+			try
+			{
+				t->call(t->callable);
+			}
+			catch(...)
+			{
+				t->state->fail(std::current_exception());
+			}
+			t->state->finish();
+		}
+	};
+
+	unsigned count;
+	std::unique_ptr<worker[]> workers;
+	std::mutex inject_mtx;
+	std::deque<details::pool_task*> injected;
+	std::atomic<size_t> injected_count{0};
+	std::atomic<bool> stopping{false};
+	std::atomic<unsigned> sleepers{0};
+	std::atomic<uint64_t> epoch{0};
+	std::mutex sleep_mtx;
+	std::condition_variable sleep_cv;
+
+public:
+	/*!
+	\param threads 工作线程数，为 0 时取硬件线程数减 1 （调用者也参与计算），
+		至少为 1
+	\param pin 把第 i 个工作线程绑定到进程可用的第 i 个 CPU （仅 Linux ）
+	*/
+	explicit thread_pool(unsigned threads = 0, bool pin = false)
+		: count(threads != 0
+				  ? threads
+				  : std::max(std::thread::hardware_concurrency(), 2U) - 1),
+		  workers(new worker[count])
+	{
+		try
+		{
+			for(unsigned i(0); i != count; ++i)
+			{
+				workers[i].thread = std::thread(&thread_pool::work, this, i);
+				if(pin)
+					pin_thread(workers[i].thread, i);
+			}
+		}
+		catch(...)
+		{
+			stop();
+			throw;
+		}
+	}
+	thread_pool(const thread_pool&) = delete;
+	~thread_pool()
+	{
+		stop();
+	}
+
+	thread_pool&
+	operator=(const thread_pool&)
+		= delete;
+
+	//! \brief 进程共享的线程池，首次使用时创建
+	static thread_pool&
+	shared()
+	{
+		static thread_pool pool;
+
+		return pool;
+	}
+
+	//! \brief 工作线程数
+	unsigned
+	size() const noexcept
+	{
+		return count;
+	}
+	//! \brief 当前线程是否本线程池的工作线程
+	bool
+	is_worker() const noexcept
+	{
+		return current() && current()->pool == this;
+	}
+
+	/*!
+	\brief 提交任务
+	\return 任务的结果和异常
+	\note 在任务中直接等待 future 会占用工作线程，应使用 wait 。
+	*/
+	template<class _fCallable>
+	auto
+	submit(_fCallable&& f)
+		-> std::future<std::result_of_t<std::decay_t<_fCallable>()>>
+	{
+		using result_type = std::result_of_t<std::decay_t<_fCallable>()>;
+		std::packaged_task<result_type()> job(std::forward<_fCallable>(f));
+		auto res(job.get_future());
+
+		spawn(new heap_task<std::packaged_task<result_type()>>(std::move(job)));
+		return res;
+	}
+	//! \brief 等待 future 就绪，期间执行其它任务
+	template<typename _type>
+	void
+	wait(const std::future<_type>& f)
+	{
+		help_until([&] {
+			return f.wait_for(std::chrono::seconds(0))
+				== std::future_status::ready;
+		},
+			[&] { f.wait_for(std::chrono::milliseconds(1)); });
+	}
+
+	/*!
+	\brief 并行调用所有函数对象，全部完成后返回
+	\note 第一个函数对象在调用线程上执行。第一个抛出的异常在全部完成后重新抛出。
+	*/
+	template<class _fFirst, class... _fRest>
+	void
+	parallel_invoke(_fFirst&& first, _fRest&&... rest)
+	{
+		details::join_state state(sizeof...(rest));
+		join_task tasks[]{{rest, state}...};
+		std::exception_ptr failure;
+
+		for(auto& t : tasks)
+			spawn(&t);
+		try
+		{
+			first();
+		}
+		catch(...)
+		{
+			failure = std::current_exception();
+		}
+		join(state);
+		if(failure)
+			std::rethrow_exception(failure);
+		state.rethrow();
+	}
+	template<class _fOnly>
+	void
+	parallel_invoke(_fOnly&& only)
+	{
+		only();
+	}
+
+	/*!
+	\brief 由至多 participants 个参与者对 [0, chunks) 中的每块执行
+		work(chunk, slot)
+	\note slot 在 [0, participants) 中标识参与者，调用线程是第 0 个，同一参与者
+		顺序执行它领取的块。块从共享的计数器领取，慢的块不会拖住其它参与者。
+	\note 第一个抛出的异常使其它参与者停止领取，在全部结束后重新抛出。
+	*/
+	template<class _fWork>
+	void
+	run_chunks(size_t chunks, unsigned participants, _fWork work)
+	{
+		if(participants <= 1 || chunks <= 1)
+		{
+			for(size_t i(0); i != chunks; ++i)
+				work(i, 0U);
+			return;
+		}
+
+		std::atomic<size_t> next{0};
+		const auto participate([&](unsigned slot) {
+			for(size_t i; (i = next.fetch_add(1)) < chunks;)
+				try
+				{
+					work(i, slot);
+				}
+				catch(...)
+				{
+					next = chunks;
+					throw;
+				}
+		});
+		struct participant
+		{
+			const decltype(participate)* body;
+			unsigned slot;
+
+			void
+			operator()() const
+			{
+				(*body)(slot);
+			}
+		};
+		const unsigned n(unsigned(std::min<size_t>(participants, chunks)));
+		vector<participant> bodies;
+		vector<join_task> tasks;
+		details::join_state state(n - 1);
+		std::exception_ptr failure;
+
+		bodies.reserve(n - 1);
+		tasks.reserve(n - 1);
+		for(unsigned s(1); s != n; ++s)
+		{
+			bodies.push_back({std::addressof(participate), s});
+			tasks.emplace_back(bodies.back(), state);
+		}
+		for(auto& t : tasks)
+			spawn(&t);
+		try
+		{
+			participate(0U);
+		}
+		catch(...)
+		{
+			failure = std::current_exception();
+		}
+		join(state);
+		if(failure)
+			std::rethrow_exception(failure);
+		state.rethrow();
+	}
+
+private:
+	static context*&
+	current() noexcept
+	{
+		static thread_local context* ctx;
+
+		return ctx;
+	}
+
+	static void
+	pin_thread(std::thread& t, unsigned i) noexcept
+	{
+#if defined(__linux__)
+		cpu_set_t allowed;
+
+		CPU_ZERO(&allowed);
+		if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+			return;
+
+		const int cpus(CPU_COUNT(&allowed));
+
+		if(cpus <= 0)
+			return;
+
+		int target(int(i % unsigned(cpus)));
+
+		for(int cpu(0); cpu != CPU_SETSIZE; ++cpu)
+			if(CPU_ISSET(cpu, &allowed) && target-- == 0)
+			{
+				cpu_set_t one;
+
+				CPU_ZERO(&one);
+				CPU_SET(cpu, &one);
+				pthread_setaffinity_np(t.native_handle(), sizeof(one), &one);
+				return;
+			}
+#else
+		static_cast<void>(t), static_cast<void>(i);
+#endif
+	}
+
+	void
+	stop() noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lck(sleep_mtx);
+
+			stopping.store(true);
+			epoch.fetch_add(1);
+		}
+		sleep_cv.notify_all();
+		for(unsigned i(0); i != count; ++i)
+			if(workers[i].thread.joinable())
+				workers[i].thread.join();
+	}
+
+	void
+	spawn(details::pool_task* t)
+	{
+		const auto ctx(current());
+
+		if(ctx && ctx->pool == this)
+			workers[ctx->index].tasks.push(t);
+		else
+		{
+			std::lock_guard<std::mutex> lck(inject_mtx);
+
+			injected.push_back(t);
+			injected_count.fetch_add(1);
+		}
+		// pairs with the check of a worker going to sleep: either it sees
+		// the new task or this sees it in sleepers
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(sleepers.load() != 0)
+		{
+			{
+				std::lock_guard<std::mutex> lck(sleep_mtx);
+
+				epoch.fetch_add(1);
+			}
+			sleep_cv.notify_one();
+		}
+	}
+
+	bool
+	has_work() const noexcept
+	{
+		if(injected_count.load() != 0)
+			return true;
+		for(unsigned i(0); i != count; ++i)
+			if(!workers[i].tasks.empty())
+				return true;
+		return false;
+	}
+
+	//! \param self 调用者的工作线程序号，不是工作线程时为 count
+	details::pool_task*
+	find_work(unsigned self, uint64_t& seed) noexcept
+	{
+		if(self != count)
+			if(const auto t = workers[self].tasks.pop())
+				return t;
+		if(injected_count.load(std::memory_order_relaxed) != 0)
+		{
+			std::lock_guard<std::mutex> lck(inject_mtx);
+
+			if(!injected.empty())
+			{
+				const auto t(injected.front());
+
+				injected.pop_front();
+				injected_count.fetch_sub(1);
+				return t;
+			}
+		}
+		// xorshift picks where to start so that thieves spread out
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+
+		const unsigned start(unsigned(seed % count));
+
+		for(unsigned k(0); k != count; ++k)
+		{
+			const unsigned victim((start + k) % count);
+
+			if(victim != self)
+				if(const auto t = workers[victim].tasks.steal())
+					return t;
+		}
+		return {};
+	}
+
+	void
+	work(unsigned index)
+	{
+		context ctx{this, index};
+		uint64_t seed(index * 0x9E3779B97F4A7C15ULL + 1);
+		details::backoff b;
+
+		current() = &ctx;
+		while(true)
+		{
+			if(const auto t = find_work(index, seed))
+			{
+				t->execute(t);
+				b.reset();
+				continue;
+			}
+			if(b.pause())
+				continue;
+
+			const uint64_t key(epoch.load());
+
+			sleepers.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(has_work())
+			{
+				sleepers.fetch_sub(1);
+				b.reset();
+				continue;
+			}
+			if(stopping.load())
+			{
+				sleepers.fetch_sub(1);
+				break;
+			}
+			{
+				std::unique_lock<std::mutex> lck(sleep_mtx);
+
+				sleep_cv.wait(lck, [&] { return epoch.load() != key; });
+			}
+			sleepers.fetch_sub(1);
+			b.reset();
+		}
+		current() = {};
+	}
+
+	//! \brief 执行任务直到 done() ，没有任务时调用 block() 短暂阻塞
+	template<class _fDone, class _fBlock>
+	void
+	help_until(_fDone done, _fBlock block)
+	{
+		const auto ctx(current());
+		const unsigned self(ctx && ctx->pool == this ? ctx->index : count);
+		uint64_t seed(reinterpret_cast<std::uintptr_t>(&seed) | 1);
+		details::backoff b;
+
+		while(!done())
+		{
+			if(const auto t = find_work(self, seed))
+			{
+				t->execute(t);
+				b.reset();
+			}
+			else if(!b.pause())
+				block();
+		}
+	}
+	void
+	join(details::join_state& state)
+	{
+		help_until([&] { return state.done(); }, [&] { state.block(); });
+		state.settle();
+	}
+};
+
+}
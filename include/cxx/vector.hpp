@@ -1,10 +1,13 @@
 #pragma once
 
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <limits>
 #include <cassert>
 #include "meta.hpp"
+#include "memory.hpp"
+#include "growth_policy.hpp"
 #include <iostream>
 
 namespace cxx
@@ -13,10 +16,42 @@ namespace cxx
 namespace details
 {
 
+//! \brief 对象内嵌的未初始化元素存储
+template<typename _type, size_t _vN>
+struct inline_buffer
+{
+	typename std::aligned_storage<sizeof(_type), alignof(_type)>::type
+		buffer[_vN];
+
+	_type*
+	inline_data() noexcept
+	{
+		return reinterpret_cast<_type*>(buffer);
+	}
+	const _type*
+	inline_data() const noexcept
+	{
+		return reinterpret_cast<const _type*>(buffer);
+	}
+};
+
+template<typename _type>
+struct inline_buffer<_type, 0>
+{
+	_type*
+	inline_data() const noexcept
+	{
+		return nullptr;
+	}
+};
+
 /*!
 \brief 向量表示类型模板
+\tparam _tGrowth 增长策略
+\tparam _vInline 对象内嵌存储能容纳的元素数，为 0 时总是使用分配器分配
 */
-template<typename _type, class _tAlloc>
+template<typename _type, class _tAlloc, class _tGrowth = default_growth,
+	size_t _vInline = 0>
 class vector_rep
 {
 public:
@@ -33,6 +68,14 @@ private:
 	using allocator_reference
 		= std::conditional_t<sizeof(elem_allocator) <= sizeof(void*),
 			elem_allocator, elem_allocator&>;
+	//! \brief 元素可以按字节在存储中移动
+	using bitwise_relocatable = and_<is_trivially_relocatable<_type>,
+		uses_default_construct<elem_allocator, _type>>;
+	//! \brief 重定位元素不会抛出异常
+	using nothrow_relocatable = or_<bitwise_relocatable,
+		std::is_nothrow_move_constructible<_type>>;
+	//! \brief 统计钩子，分配器不支持统计时为空操作
+	using stats_hook = container_hook<elem_allocator>;
 
 public:
 	using pointer = typename elem_ator_traits::pointer;
@@ -61,7 +104,7 @@ private:
 			capacity = x.capacity;
 		}
 		void
-		swap_data(const vector_header& x) noexcept
+		swap_data(vector_header& x) noexcept
 		{
 			vector_header tmp;
 			tmp.copy_data(*this);
@@ -71,7 +114,7 @@ private:
 	};
 
 protected:
-	struct components : elem_allocator
+	struct components : elem_allocator, inline_buffer<_type, _vInline>
 	{
 		using base = elem_allocator;
 		vector_header header{};
@@ -79,17 +122,32 @@ protected:
 		components() noexcept(
 			std::is_nothrow_default_constructible<elem_allocator>())
 			: base()
-		{}
+		{
+			reset_header();
+		}
 		explicit components(elem_allocator a) noexcept : base(std::move(a))
-		{}
+		{
+			reset_header();
+		}
 		components(const components& x)
 			: base(elem_ator_traits::select_on_container_copy_construction(
 				  x.get()))
-		{}
-		components(components&&) = default;
-		components(components&& x, elem_allocator a) noexcept
-			: base(std::move(a)), header(std::move(x.header))
-		{}
+		{
+			reset_header();
+		}
+		//! \brief 置为空的初始状态，不释放存储
+		void
+		reset_header() noexcept
+		{
+			header.data = this->inline_data();
+			header.size = 0;
+			header.capacity = _vInline;
+		}
+		bool
+		is_inline() const noexcept
+		{
+			return _vInline != 0 && header.data == this->inline_data();
+		}
 		elem_allocator&
 		get() noexcept
 		{
@@ -116,21 +174,32 @@ public:
 	{
 		create_storage(n);
 	}
-	vector_rep(vector_rep&&) = default;
+	vector_rep(vector_rep&& x) noexcept(nothrow_steal::value)
+		: objects(std::move(x.get_elem_allocator()))
+	{
+		steal_storage(x);
+	}
 	vector_rep(vector_rep&& x, const allocator_type& a) noexcept(
-		elem_ator_traits::is_always_equal::value)
+		and_<typename elem_ator_traits::is_always_equal, nothrow_steal>::value)
 		: vector_rep(std::move(x), elem_allocator(a),
 			  typename elem_ator_traits::is_always_equal())
 	{}
 
 private:
-	vector_rep(vector_rep&& x, elem_allocator a, true_) noexcept
-		: objects(std::move(x.objects), std::move(a))
-	{}
+	//! \brief 内嵌存储中的元素只能逐个重定位，此时移动可能抛出异常
+	using nothrow_steal = bool_<_vInline == 0
+		|| std::is_nothrow_move_constructible<_type>::value>;
+
+	vector_rep(vector_rep&& x, elem_allocator a, true_) noexcept(
+		nothrow_steal::value)
+		: objects(std::move(a))
+	{
+		steal_storage(x);
+	}
 	vector_rep(vector_rep&& x, elem_allocator a, false_) : objects(std::move(a))
 	{
 		if(get_elem_allocator() == x.get_elem_allocator())
-			objects.header.swap_data(x.objects.header);
+			steal_storage(x);
 		else
 			insert_range(begin(), std::make_move_iterator(x.begin()),
 				std::make_move_iterator(x.end()));
@@ -140,9 +209,93 @@ private:
 	void
 	create_storage(size_type n)
 	{
-		objects.header.data = allocate_storage(n);
-		objects.header.size = 0;
-		objects.header.capacity = n;
+		if(n <= _vInline)
+			objects.reset_header();
+		else
+		{
+			objects.header.data = allocate_storage(n);
+			objects.header.size = 0;
+			objects.header.capacity = n;
+		}
+	}
+	/*!
+	\brief 取得 x 的元素，x 置为空
+	\pre 本对象为空且使用内嵌存储或没有存储；两者的分配器相等。
+	\note 堆上的存储直接转移；内嵌存储中的元素逐个重定位。
+	*/
+	void
+	steal_storage(vector_rep& x) noexcept(nothrow_steal::value)
+	{
+		if(x.objects.is_inline())
+		{
+			allocator_reference a(get_elem_allocator());
+
+			details::uninitialized_relocate(a, x.begin(), x.end(), begin());
+			objects.header.size = x.size();
+			x.objects.header.size = 0;
+		}
+		else
+		{
+			objects.header.copy_data(x.objects.header);
+			x.objects.reset_header();
+		}
+	}
+	//! \brief 销毁所有元素并释放堆上的存储
+	void
+	release_storage() noexcept
+	{
+		note_release();
+		clear();
+		deallocate_storage(objects.header.data, capacity());
+		objects.reset_header();
+	}
+	void
+	move_assign(vector_rep& x, true_) noexcept(nothrow_steal::value)
+	{
+		release_storage();
+		propagate_allocator(x.get_elem_allocator(),
+			typename elem_ator_traits::propagate_on_container_move_assignment());
+		steal_storage(x);
+	}
+	void
+	move_assign(vector_rep& x, false_)
+	{
+		if(get_elem_allocator() == x.get_elem_allocator())
+			move_assign(x, true_());
+		else
+			assign_range(std::make_move_iterator(x.begin()),
+				std::make_move_iterator(x.end()));
+	}
+	void
+	copy_assign_allocator(const vector_rep& x, true_)
+	{
+		if(get_elem_allocator() != x.get_elem_allocator())
+			release_storage();
+		get_elem_allocator() = x.get_elem_allocator();
+	}
+	void
+	copy_assign_allocator(const vector_rep&, false_) noexcept
+	{}
+	void
+	propagate_allocator(elem_allocator& a, true_) noexcept
+	{
+		get_elem_allocator() = std::move(a);
+	}
+	void
+	propagate_allocator(elem_allocator&, false_) noexcept
+	{}
+	void
+	swap_allocator(vector_rep& x, true_) noexcept
+	{
+		using std::swap;
+
+		swap(get_elem_allocator(), x.get_elem_allocator());
+	}
+	void
+	swap_allocator(vector_rep& x, false_) noexcept
+	{
+		assert(get_elem_allocator() == x.get_elem_allocator());
+		static_cast<void>(x);
 	}
 	pointer
 	allocate_storage(size_type n)
@@ -153,8 +306,11 @@ private:
 	void
 	deallocate_storage(pointer p, size_type n)
 	{
-		allocator_reference a(get_elem_allocator());
-		elem_ator_traits::deallocate(a, p, n);
+		if(p != objects.inline_data())
+		{
+			allocator_reference a(get_elem_allocator());
+			elem_ator_traits::deallocate(a, p, n);
+		}
 	}
 	template<typename... _tParams>
 	void
@@ -169,10 +325,19 @@ private:
 		allocator_reference a(get_elem_allocator());
 		elem_ator_traits::destroy(a, p);
 	}
+	void
+	note_release() const noexcept
+	{
+		if(capacity() != 0)
+			stats_hook::release(get_elem_allocator(), size(), capacity(),
+				sizeof(value_type));
+	}
 
 public:
 	~vector_rep()
 	{
+		note_release();
+		clear();
 		deallocate_storage(objects.header.data, capacity());
 	}
 	vector_rep&
@@ -180,6 +345,9 @@ public:
 	{
 		if(std::addressof(x) != this)
 		{
+			copy_assign_allocator(x,
+				typename elem_ator_traits::
+					propagate_on_container_copy_assignment());
 			assign_range(x.begin(), x.end());
 		}
 		return *this;
@@ -187,22 +355,87 @@ public:
 	vector_rep&
 	operator=(vector_rep&& x)
 	{
-		assign_range(std::make_move_iterator(x.begin()),
-			std::make_move_iterator(x.end()));
+		if(std::addressof(x) != this)
+			move_assign(x,
+				or_<typename elem_ator_traits::
+						propagate_on_container_move_assignment,
+					typename elem_ator_traits::is_always_equal>());
 		return *this;
 	}
+	void
+	swap(vector_rep& x) noexcept(nothrow_steal::value)
+	{
+		if(std::addressof(x) == this)
+			return;
+		if(!objects.is_inline() && !x.objects.is_inline())
+			objects.header.swap_data(x.objects.header);
+		else
+		{
+			vector_rep tmp(x.get_allocator());
+
+			tmp.steal_storage(x);
+			x.steal_storage(*this);
+			steal_storage(tmp);
+		}
+		swap_allocator(x,
+			typename elem_ator_traits::propagate_on_container_swap());
+	}
 	template<typename _tIn>
 	void
 	init_range(_tIn first, _tIn last)
+	{
+		init_range(first, last,
+			typename std::iterator_traits<_tIn>::iterator_category());
+	}
+
+private:
+	template<typename _tIn>
+	void
+	init_range(_tIn first, _tIn last, std::input_iterator_tag)
 	{
 		for(; first != last; ++first)
-			insert_it(end(), *first);
+			emplace_back(*first);
 	}
+	template<typename _tFwd>
+	void
+	init_range(_tFwd first, _tFwd last, std::forward_iterator_tag)
+	{
+		append_range(first, last);
+	}
+
+public:
+	/*!
+	\brief 区间的元素数，用于预先分配存储
+	\note 输入迭代器区间只能遍历一次，此时返回 0 。
+	*/
+	template<typename _tIn>
+	static size_type
+	range_size(_tIn first, _tIn last)
+	{
+		return range_size(first, last,
+			typename std::iterator_traits<_tIn>::iterator_category());
+	}
+
+private:
+	template<typename _tIn>
+	static size_type
+	range_size(_tIn, _tIn, std::input_iterator_tag) noexcept
+	{
+		return 0;
+	}
+	template<typename _tFwd>
+	static size_type
+	range_size(_tFwd first, _tFwd last, std::forward_iterator_tag)
+	{
+		return size_type(std::distance(first, last));
+	}
+
+public:
 	template<typename _tIn>
 	void
 	assign_range(_tIn first, _tIn last)
 	{
-		reserve(std::distance(first, last));
+		reserve(range_size(first, last));
 		auto i(begin());
 		const auto j(end());
 
@@ -313,15 +546,66 @@ public:
 		sz -= len;
 		return i;
 	}
-	//! \brief 在容器末尾插入 n 个默认值
+	//! \brief 在容器末尾插入 n 个值初始化的元素
 	void
 	append_default(size_type n)
 	{
-		if(size() + n > capacity())
-			reserve(1.5 * capacity() + n);
+		grow_for(n);
 
-		for(auto current(end()); n != 0; ++current, --n)
-			insert_it(current, value_type());
+		allocator_reference a(get_elem_allocator());
+
+		details::uninitialized_value_construct_n(a, end(), n);
+		objects.header.size += n;
+	}
+	//! \brief 在容器末尾插入 n 个 val 的副本
+	void
+	append_fill(size_type n, const value_type& val)
+	{
+		grow_for(n);
+
+		allocator_reference a(get_elem_allocator());
+
+		details::uninitialized_fill_n(a, end(), n, val);
+		objects.header.size += n;
+	}
+	//! \brief 在容器末尾插入前向迭代器区间中的元素
+	template<typename _tFwd>
+	void
+	append_range(_tFwd first, _tFwd last)
+	{
+		const size_type n(std::distance(first, last));
+
+		grow_for(n);
+
+		allocator_reference a(get_elem_allocator());
+
+		details::uninitialized_copy(a, first, last, end());
+		objects.header.size += n;
+	}
+	//! \brief 按增长策略计算再放入 n 个元素时的新容量
+	size_type
+	next_capacity(size_type n) const
+	{
+		const size_type max_n(max_size());
+
+		if(n > max_n - size())
+			throw std::length_error("vector: n > max_size() - size()");
+		return _tGrowth::next_capacity(
+			capacity(), n, max_n, sizeof(value_type));
+	}
+	//! \brief 按增长策略保证能再放入 n 个元素
+	void
+	grow_for(size_type n)
+	{
+		if(n > capacity() - size())
+			reserve(next_capacity(n));
+	}
+	//! \brief 用户显式请求的 reserve ，同时报告给统计钩子
+	void
+	reserve_requested(size_type n)
+	{
+		stats_hook::reserve_call(get_elem_allocator(), n, capacity());
+		reserve(n);
 	}
 	void
 	reserve(size_type n)
@@ -333,12 +617,19 @@ public:
 
 		pointer tmp = allocate_storage(n);
 
-		for(size_type i(0); i < size(); ++i)
-			construct_storage(&tmp[i], objects.header.data[i]);
-
-		for(size_type i(0); i < size(); ++i)
-			destroy_storage(&objects.header.data[i]);
+		try
+		{
+			allocator_reference a(get_elem_allocator());
 
+			details::uninitialized_relocate(a, begin(), end(), tmp);
+		}
+		catch(...)
+		{
+			deallocate_storage(tmp, n);
+			throw;
+		}
+		stats_hook::grow(
+			get_elem_allocator(), capacity(), n, size(), sizeof(value_type));
 		deallocate_storage(objects.header.data, capacity());
 		objects.header.data = tmp;
 		objects.header.capacity = n;
@@ -352,31 +643,48 @@ public:
 		construct_storage(position, std::forward<_tParams>(args)...);
 		++objects.header.size;
 	}
+	template<typename... _tParams>
+	void
+	emplace_back(_tParams&&... args)
+	{
+		grow_for(1);
+		insert_it(end(), std::forward<_tParams>(args)...);
+	}
 	template<typename _tIn>
 	iterator
 	insert_range(iterator position, _tIn first, _tIn last)
 	{
-		if(first != last)
-		{
-			const size_type n(std::distance(first, last));
-			const size_type dist(std::distance(position, end()));
-			if(size() + n > capacity())
-				reserve(1.5 * capacity() + n);
+		return insert_range(position, first, last,
+			typename std::iterator_traits<_tIn>::iterator_category());
+	}
+	iterator
+	insert_fill(iterator position, size_type n, const value_type& val)
+	{
+		const size_type off(position - begin());
 
-			const auto backit(end() - 1);
-			auto current(backit + n);
+		if(n == 0)
+			return position;
+		if(n > capacity() - size())
+			realloc_insert(off, n, [&](pointer p) {
+				allocator_reference a(get_elem_allocator());
 
-			for(; current != backit + n - dist; --current)
-				insert_it(current, *(current - n));
+				details::uninitialized_fill_n(a, p, n, val);
+			});
+		else
+		{
+			const value_type copy(val);
 
-			for(; current != backit; --current, static_cast<void>(--last))
-				insert_it(current, *(last - 1));
+			insert_in_place(
+				off, n,
+				[&](pointer p, size_type k) {
+					allocator_reference a(get_elem_allocator());
 
-			for(; first != last; --current, static_cast<void>(--last))
-				*current = *(last - 1);
-			return current;
+					details::uninitialized_fill_n(a, p, k, copy);
+				},
+				[&](pointer p, size_type k) { std::fill_n(p, k, copy); },
+				bitwise_relocatable());
 		}
-		return position;
+		return begin() + off;
 	}
 	void
 	erase_it(iterator position) noexcept
@@ -384,53 +692,282 @@ public:
 		destroy_storage(position);
 		--objects.header.size;
 	}
-	void
+	iterator
 	erase_range(iterator first, iterator last) noexcept
 	{
-		for(; last != end(); ++first, ++last)
-			*first = std::move(*last);
-
-		while(first != last)
-		{
-			erase_it(last);
-			--last;
-		}
+		if(first != last)
+			erase_range(first, last, bitwise_relocatable());
+		return first;
 	}
 	template<typename... _tParams>
 	iterator
 	emplace(const_iterator position, _tParams&&... args)
 	{
-		const size_type dist(
-			std::distance(begin(), const_cast<iterator>(position)));
+		const auto pos(const_cast<iterator>(position));
+		const size_type off(pos - begin());
 
 		if(size() == capacity())
-			reserve(1.5 * capacity() + 1);
+			realloc_insert(off, 1, [&](pointer p) {
+				construct_storage(p, std::forward<_tParams>(args)...);
+			});
+		else if(pos == end())
+			insert_it(pos, std::forward<_tParams>(args)...);
+		else
+		{
+			// NOTE: The arguments may refer to the elements to be shifted.
+			value_type tmp(std::forward<_tParams>(args)...);
 
-		insert_it(end(), *(end() - 1));
-		auto current(end() - 1);
-		for(; current != begin() + dist; --current)
-			*current = std::move(*(current - 1));
-		*current = {std::forward<_tParams>(args)...};
-		return current;
+			insert_in_place(
+				off, 1,
+				[&](pointer p, size_type k) {
+					if(k != 0)
+						construct_storage(p, std::move(tmp));
+				},
+				[&](pointer p, size_type) { *p = std::move(tmp); },
+				bitwise_relocatable());
+		}
+		return begin() + off;
 	}
+
+private:
+	template<typename _tIn>
+	iterator
+	insert_range(
+		iterator position, _tIn first, _tIn last, std::input_iterator_tag)
+	{
+		const size_type off(position - begin()), old_size(size());
+
+		for(; first != last; ++first)
+			emplace_back(*first);
+		std::rotate(begin() + off, begin() + old_size, end());
+		return begin() + off;
+	}
+	template<typename _tFwd>
+	iterator
+	insert_range(
+		iterator position, _tFwd first, _tFwd last, std::forward_iterator_tag)
+	{
+		const size_type off(position - begin());
+		const size_type n(std::distance(first, last));
+
+		if(n == 0)
+			return position;
+		if(position == end())
+			append_range(first, last);
+		else if(n > capacity() - size())
+			realloc_insert(off, n, [&](pointer p) {
+				allocator_reference a(get_elem_allocator());
+
+				details::uninitialized_copy(a, first, last, p);
+			});
+		else
+			insert_in_place(
+				off, n,
+				[&](pointer p, size_type k) {
+					allocator_reference a(get_elem_allocator());
+					auto i(first);
+
+					std::advance(i, n - k);
+					details::uninitialized_copy(a, i, last, p);
+				},
+				[&](pointer p, size_type k) {
+					auto i(first);
+
+					std::advance(i, k);
+					std::copy(first, i, p);
+				},
+				bitwise_relocatable());
+		return begin() + off;
+	}
+
+	/*!
+	\brief 分配新存储，在偏移 off 处构造 n 个新元素并把原有元素重定位到两侧
+	\param construct 在给定的未初始化存储上构造 n 个元素
+	\note 每个原有元素只移动一次。构造新元素失败时容器不变。
+	*/
+	template<typename _fConstruct>
 	void
-	clear() noexcept
+	realloc_insert(size_type off, size_type n, _fConstruct construct)
+	{
+		const size_type len(next_capacity(n));
+		const pointer tmp(allocate_storage(len));
+
+		try
+		{
+			construct(tmp + off);
+		}
+		catch(...)
+		{
+			deallocate_storage(tmp, len);
+			throw;
+		}
+		relocate_around(tmp, off, n, len, nothrow_relocatable());
+		stats_hook::grow(
+			get_elem_allocator(), capacity(), len, size(), sizeof(value_type));
+		deallocate_storage(objects.header.data, capacity());
+		objects.header.data = tmp;
+		objects.header.size += n;
+		objects.header.capacity = len;
+	}
+	void
+	relocate_around(pointer tmp, size_type off, size_type n, size_type,
+		true_) noexcept
+	{
+		allocator_reference a(get_elem_allocator());
+		const auto pos(begin() + off);
+
+		details::uninitialized_relocate(a, begin(), pos, tmp);
+		details::uninitialized_relocate(a, pos, end(), tmp + off + n);
+	}
+	void
+	relocate_around(
+		pointer tmp, size_type off, size_type n, size_type len, false_)
+	{
+		allocator_reference a(get_elem_allocator());
+		const auto pos(begin() + off);
+
+		try
+		{
+			details::uninitialized_move_if_noexcept(a, begin(), pos, tmp);
+			try
+			{
+				details::uninitialized_move_if_noexcept(
+					a, pos, end(), tmp + off + n);
+			}
+			catch(...)
+			{
+				details::destroy_range(a, tmp, tmp + off);
+				throw;
+			}
+		}
+		catch(...)
+		{
+			details::destroy_range(a, tmp + off, tmp + off + n);
+			deallocate_storage(tmp, len);
+			throw;
+		}
+		details::destroy_range(a, begin(), end());
+	}
+
+	/*!
+	\brief 在容量足够时于偏移 off 处插入 n 个元素
+	\param construct 在未初始化存储上构造新元素的后 k 个
+	\param assign 对已有元素赋值为新元素的前 k 个
+	\note 可按字节重定位的元素整体 memmove 一次后直接在空位中构造，
+		否则移动尾部元素一次后对空位中已有的元素赋值。
+	*/
+	template<typename _fConstruct, typename _fAssign>
+	void
+	insert_in_place(size_type off, size_type n, _fConstruct construct,
+		_fAssign, true_)
+	{
+		// the position is taken from the storage here rather than from the
+		// caller, so that the compiler never pairs it with a null end()
+		const auto position(begin() + off);
+		const auto old_end(end());
+		const size_type after(old_end - position);
+
+		stats_hook::shift(get_elem_allocator(), after, sizeof(value_type));
+		if(after != 0)
+			std::memmove(static_cast<void*>(position + n),
+				static_cast<void*>(position), after * sizeof(value_type));
+		try
+		{
+			construct(position, n);
+		}
+		catch(...)
+		{
+			if(after != 0)
+				std::memmove(static_cast<void*>(position),
+					static_cast<void*>(position + n), after * sizeof(value_type));
+			throw;
+		}
+		objects.header.size += n;
+	}
+	template<typename _fConstruct, typename _fAssign>
+	void
+	insert_in_place(size_type off, size_type n, _fConstruct construct,
+		_fAssign assign, false_)
 	{
-		iterator i(end() - 1);
-		while(!empty())
+		allocator_reference a(get_elem_allocator());
+		const auto position(begin() + off);
+		const auto old_end(end());
+		const size_type after(old_end - position);
+
+		stats_hook::shift(get_elem_allocator(), after, sizeof(value_type));
+		if(after > n)
+		{
+			details::uninitialized_move(a, old_end - n, old_end, old_end);
+			objects.header.size += n;
+			std::move_backward(position, old_end - n, old_end);
+			assign(position, n);
+		}
+		else
 		{
-			erase_it(i);
-			--i;
+			construct(old_end, n - after);
+			objects.header.size += n - after;
+			try
+			{
+				details::uninitialized_move(
+					a, position, old_end, position + n);
+			}
+			catch(...)
+			{
+				details::destroy_range(a, old_end, end());
+				objects.header.size -= n - after;
+				throw;
+			}
+			objects.header.size += after;
+			assign(position, after);
 		}
 	}
+
+	void
+	erase_range(iterator first, iterator last, true_) noexcept
+	{
+		allocator_reference a(get_elem_allocator());
+
+		stats_hook::shift(
+			get_elem_allocator(), size_type(end() - last), sizeof(value_type));
+		details::destroy_range(a, first, last);
+		std::memmove(static_cast<void*>(first), static_cast<void*>(last),
+			(end() - last) * sizeof(value_type));
+		objects.header.size -= last - first;
+	}
+	void
+	erase_range(iterator first, iterator last, false_) noexcept
+	{
+		allocator_reference a(get_elem_allocator());
+
+		stats_hook::shift(
+			get_elem_allocator(), size_type(end() - last), sizeof(value_type));
+
+		const auto new_end(std::move(last, end(), first));
+
+		details::destroy_range(a, new_end, end());
+		objects.header.size -= end() - new_end;
+	}
+
+public:
+	void
+	clear() noexcept
+	{
+		allocator_reference a(get_elem_allocator());
+
+		details::destroy_range(a, begin(), end());
+		objects.header.size = 0;
+	}
 };
 
 }
 
 /*!
 \brief 向量容器
+\tparam _tGrowth 增长策略，参见 growth_policy.hpp
+\tparam _vInline 内嵌存储的元素数，参见 small_vector
 */
-template<typename _type, class _tAlloc = std::allocator<_type>>
+template<typename _type, class _tAlloc = std::allocator<_type>,
+	class _tGrowth = default_growth, size_t _vInline = 0>
 class vector
 {
 public:
@@ -443,7 +980,7 @@ public:
 
 private:
 	using ator_traits = allocator_traits<allocator_type>;
-	using rep_type = details::vector_rep<_type, _tAlloc>;
+	using rep_type = details::vector_rep<_type, _tAlloc, _tGrowth, _vInline>;
 
 public:
 	using pointer = typename ator_traits::pointer;
@@ -467,8 +1004,7 @@ public:
 	explicit vector(size_type n, const allocator_type& a = allocator_type())
 		: rep(n, a)
 	{
-		for(; n != 0; --n)
-			emplace_back();
+		rep.append_default(n);
 	}
 	vector(size_type n, const value_type& val,
 		const allocator_type& a = allocator_type())
@@ -478,7 +1014,7 @@ public:
 	}
 	template<typename _tIn, typename = enable_for_input_iterator_t<_tIn>>
 	vector(_tIn first, _tIn last, const allocator_type& a = allocator_type())
-		: rep(std::distance(first, last), a)
+		: rep(rep_type::range_size(first, last), a)
 	{
 		init_range(first, last);
 	}
@@ -488,7 +1024,10 @@ public:
 	{
 		init_range(il.begin(), il.end());
 	}
-	vector(const vector& x) : rep(x.size())
+	vector(const vector& x)
+		: rep(x.size(),
+			  ator_traits::select_on_container_copy_construction(
+				  x.get_allocator()))
 	{
 		init_range(x.begin(), x.end());
 	}
@@ -497,7 +1036,8 @@ public:
 		init_range(x.begin(), x.end());
 	}
 	vector(vector&&) = default;
-	vector(vector&& x, const allocator_type& a);
+	vector(vector&& x, const allocator_type& a) : rep(std::move(x.rep), a)
+	{}
 
 public:
 	~vector() = default;
@@ -533,8 +1073,7 @@ private:
 	void
 	init_fill(size_type n, const value_type& val)
 	{
-		for(; n != 0; --n)
-			push_back(val);
+		rep.append_fill(n, val);
 	}
 	template<typename _tIn>
 	void
@@ -545,7 +1084,7 @@ private:
 	void
 	assign_fill(size_type n, const value_type& val)
 	{
-		reserve(n);
+		rep.reserve(n);
 		iterator i = begin();
 		for(; i != end() && n > 0; ++i, --n)
 			*i = val;
@@ -650,7 +1189,7 @@ public:
 	void
 	reserve(size_type n)
 	{
-		rep.reserve(n);
+		rep.reserve_requested(n);
 	}
 	reference
 	operator[](size_type pos)
@@ -735,26 +1274,7 @@ public:
 	iterator
 	insert(const_iterator position, size_type n, const value_type& val)
 	{
-		const size_type dist(std::distance(position, cend()));
-		if(n != 0)
-		{
-			if(size() + n > capacity())
-				reserve(1.5 * capacity() + n);
-
-			const auto backit(end() - 1);
-			auto current(backit + n);
-
-			for(; current != backit + n - dist; --current)
-				rep.insert_it(current, *(current - n));
-
-			for(; current != backit; --current, --n)
-				rep.insert_it(current, val);
-
-			for(; n != 0; --current, --n)
-				*current = val;
-			return begin() + dist;
-		}
-		return begin() + dist;
+		return rep.insert_fill(const_cast<iterator>(position), n, val);
 	}
 	template<typename _tIn, typename = enable_for_input_iterator_t<_tIn>>
 	iterator
@@ -771,19 +1291,17 @@ public:
 	iterator
 	erase(const_iterator position)
 	{
-		auto current(const_cast<iterator>(position));
-		const auto result(current);
-		for(; current != end() - 1; ++current)
-			*current = std::move(*(current + 1));
-		rep.erase_it(end() - 1);
-		return result;
+		assert(position != cend());
+
+		const auto first(const_cast<iterator>(position));
+
+		return rep.erase_range(first, first + 1);
 	}
 	iterator
 	erase(const_iterator first, const_iterator last)
 	{
-		auto result(const_cast<iterator>(last));
-		rep.erase_range(const_cast<iterator>(first), result);
-		return result;
+		return rep.erase_range(
+			const_cast<iterator>(first), const_cast<iterator>(last));
 	}
 	void
 	push_back(const value_type& val)
@@ -799,9 +1317,7 @@ public:
 	reference
 	emplace_back(_tParams&&... args)
 	{
-		if(size() == capacity())
-			reserve(1.5 * capacity() + 1);
-		rep.insert_it(end(), std::forward<_tParams>(args)...);
+		rep.emplace_back(std::forward<_tParams>(args)...);
 		return back();
 	}
 	void
@@ -830,6 +1346,25 @@ public:
 		else
 			erase(i, end());
 	}
+	void
+	swap(vector& x) noexcept(noexcept(rep.swap(x.rep)))
+	{
+		rep.swap(x.rep);
+	}
+	friend void
+	swap(vector& x, vector& y) noexcept(noexcept(x.swap(y)))
+	{
+		x.swap(y);
+	}
 };
 
+/*!
+\brief 小缓冲区优化的向量容器
+\note 不超过 _vN 个元素时存储在对象内，超过时转移到分配器分配的存储。
+\note 移动和交换内嵌存储中的元素需要逐个重定位元素。
+*/
+template<typename _type, size_t _vN, class _tAlloc = std::allocator<_type>,
+	class _tGrowth = default_growth>
+using small_vector = vector<_type, _tAlloc, _tGrowth, _vN>;
+
 }
\ No newline at end of file
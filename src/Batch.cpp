@@ -0,0 +1,349 @@
+#include "Batch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#if defined(__AVX__)
+#	include <immintrin.h>
+#	define CXX_BATCH_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#	include <emmintrin.h>
+#	define CXX_BATCH_SIMD 1
+#endif
+
+namespace cxx
+{
+
+namespace
+{
+
+// rows evaluated together; one block of every stack entry stays in L1
+constexpr size_t block_rows = 256;
+
+#if defined(__AVX__)
+struct simd
+{
+	using pack = __m256d;
+	static constexpr size_t width = 4;
+
+	static pack
+	load(const double* p)
+	{
+		return _mm256_loadu_pd(p);
+	}
+	static void
+	store(double* p, pack x)
+	{
+		_mm256_storeu_pd(p, x);
+	}
+	static pack
+	set1(double x)
+	{
+		return _mm256_set1_pd(x);
+	}
+	static pack
+	add(pack x, pack y)
+	{
+		return _mm256_add_pd(x, y);
+	}
+	static pack
+	sub(pack x, pack y)
+	{
+		return _mm256_sub_pd(x, y);
+	}
+	static pack
+	mul(pack x, pack y)
+	{
+		return _mm256_mul_pd(x, y);
+	}
+	static pack
+	div(pack x, pack y)
+	{
+		return _mm256_div_pd(x, y);
+	}
+	static pack
+	is_zero(pack x)
+	{
+		return _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_EQ_OQ);
+	}
+	static pack
+	select(pack mask, pack x, pack y)
+	{
+		return _mm256_blendv_pd(y, x, mask);
+	}
+	static unsigned
+	bits(pack mask)
+	{
+		return unsigned(_mm256_movemask_pd(mask));
+	}
+};
+#elif CXX_BATCH_SIMD
+struct simd
+{
+	using pack = __m128d;
+	static constexpr size_t width = 2;
+
+	static pack
+	load(const double* p)
+	{
+		return _mm_loadu_pd(p);
+	}
+	static void
+	store(double* p, pack x)
+	{
+		_mm_storeu_pd(p, x);
+	}
+	static pack
+	set1(double x)
+	{
+		return _mm_set1_pd(x);
+	}
+	static pack
+	add(pack x, pack y)
+	{
+		return _mm_add_pd(x, y);
+	}
+	static pack
+	sub(pack x, pack y)
+	{
+		return _mm_sub_pd(x, y);
+	}
+	static pack
+	mul(pack x, pack y)
+	{
+		return _mm_mul_pd(x, y);
+	}
+	static pack
+	div(pack x, pack y)
+	{
+		return _mm_div_pd(x, y);
+	}
+	static pack
+	is_zero(pack x)
+	{
+		return _mm_cmpeq_pd(x, _mm_setzero_pd());
+	}
+	static pack
+	select(pack mask, pack x, pack y)
+	{
+		return _mm_or_pd(_mm_and_pd(mask, x), _mm_andnot_pd(mask, y));
+	}
+	static unsigned
+	bits(pack mask)
+	{
+		return unsigned(_mm_movemask_pd(mask));
+	}
+};
+#else
+// only the operations that apply() names; the loops below skip SIMD
+struct simd
+{
+	static double
+	add(double x, double y)
+	{
+		return x + y;
+	}
+	static double
+	sub(double x, double y)
+	{
+		return x - y;
+	}
+	static double
+	mul(double x, double y)
+	{
+		return x * y;
+	}
+};
+#endif
+
+// x[i] = op(x[i], y[i]) for i in [0, n)
+template<class _fPack, class _fScalar>
+inline void
+apply(double* x, const double* y, size_t n, _fPack fp, _fScalar fs)
+{
+	size_t i = 0;
+#if CXX_BATCH_SIMD
+	for(; i + simd::width <= n; i += simd::width)
+		simd::store(x + i, fp(simd::load(x + i), simd::load(y + i)));
+#else
+	static_cast<void>(fp);
+#endif
+	for(; i < n; ++i)
+		x[i] = fs(x[i], y[i]);
+}
+
+constexpr double nan_value = numeric_limits<double>::quiet_NaN();
+
+// x[i] /= y[i]; rows with a zero divisor get NaN and an error flag
+inline void
+divide(double* x, const double* y, size_t n, unsigned char* err)
+{
+	size_t i = 0;
+#if CXX_BATCH_SIMD
+	const auto nan = simd::set1(nan_value);
+
+	for(; i + simd::width <= n; i += simd::width)
+	{
+		const auto d = simd::load(y + i);
+		const auto z = simd::is_zero(d);
+
+		simd::store(
+			x + i, simd::select(z, nan, simd::div(simd::load(x + i), d)));
+		if(const unsigned m = simd::bits(z))
+			for(size_t k = 0; k < simd::width; ++k)
+				err[i + k] |= (m >> k) & 1;
+	}
+#endif
+	for(; i < n; ++i)
+		if(y[i] == 0)
+		{
+			x[i] = nan_value;
+			err[i] |= row_divide_by_zero;
+		}
+		else
+			x[i] /= y[i];
+}
+
+// fmod has no SIMD form; the zero checks still happen per row
+inline void
+modulo(double* x, const double* y, size_t n, unsigned char* err)
+{
+	for(size_t i = 0; i < n; ++i)
+		if(y[i] == 0)
+		{
+			x[i] = nan_value;
+			err[i] |= row_divide_by_zero;
+		}
+		else
+			x[i] = fmod(x[i], y[i]);
+}
+
+} // unnamed namespace;
+
+
+void
+ColumnBindings::Bind(string_view id, const vector<double>& col)
+{
+	if(col.size() < rows)
+		throw runtime_error(format(
+			"ColumnBindings::Bind: column '{}' has {} rows, {} expected.", id,
+			col.size(), rows));
+	Bind(env.Slot(id), col.data());
+}
+
+void
+ColumnBindings::Bind(size_t slot, const double* col)
+{
+	if(slot >= columns.size())
+		columns.resize(slot + 1);
+	columns[slot] = col;
+}
+
+ColumnBindings
+ColumnBindings::Slice(size_t first, size_t n) const
+{
+	assert(first + n <= rows);
+
+	ColumnBindings res(env, n);
+
+	res.columns = columns;
+	for(auto& col : res.columns)
+		if(col)
+			col += first;
+	return res;
+}
+
+
+size_t
+EvaluateBatch(const Program& prog, const ColumnBindings& cols, double* out,
+	unsigned char* errors)
+{
+	const auto& code = prog.Code();
+	const auto& constants = prog.Constants();
+	const Environment& env = cols.GetEnvironment();
+	const size_t rows = cols.Rows();
+	vector<double> stack(
+		(prog.StackDepth() + prog.TempCount()) * block_rows);
+	double* const temps = stack.data() + prog.StackDepth() * block_rows;
+
+	for(size_t base = 0; base < rows; base += block_rows)
+	{
+		const size_t n = min(block_rows, rows - base);
+		unsigned char* err = errors + base;
+		double* sp = stack.data();
+
+		memset(err, row_ok, n);
+		for(const auto& ins : code)
+			switch(ins.op)
+			{
+			case Opcode::constant:
+				fill_n(sp, n, constants[ins.operand]);
+				sp += block_rows;
+				break;
+			case Opcode::load:
+				if(const double* col = cols.Column(ins.operand))
+					memcpy(sp, col + base, n * sizeof(double));
+				else
+					fill_n(sp, n, env.Value(ins.operand));
+				sp += block_rows;
+				break;
+			case Opcode::negate:
+				for(double *p = sp - block_rows, *e = p + n; p != e; ++p)
+					*p = -*p;
+				break;
+			case Opcode::add:
+				sp -= block_rows;
+				apply(
+					sp - block_rows, sp, n,
+					[](auto x, auto y) { return simd::add(x, y); },
+					[](double x, double y) { return x + y; });
+				break;
+			case Opcode::subtract:
+				sp -= block_rows;
+				apply(
+					sp - block_rows, sp, n,
+					[](auto x, auto y) { return simd::sub(x, y); },
+					[](double x, double y) { return x - y; });
+				break;
+			case Opcode::multiply:
+				sp -= block_rows;
+				apply(
+					sp - block_rows, sp, n,
+					[](auto x, auto y) { return simd::mul(x, y); },
+					[](double x, double y) { return x * y; });
+				break;
+			case Opcode::divide:
+				sp -= block_rows;
+				divide(sp - block_rows, sp, n, err);
+				break;
+			case Opcode::modulo:
+				sp -= block_rows;
+				modulo(sp - block_rows, sp, n, err);
+				break;
+			case Opcode::store:
+				memcpy(temps + ins.operand * block_rows, sp - block_rows,
+					n * sizeof(double));
+				break;
+			case Opcode::reuse:
+				memcpy(sp, temps + ins.operand * block_rows, n * sizeof(double));
+				sp += block_rows;
+				break;
+			}
+		memcpy(out + base, stack.data(), n * sizeof(double));
+	}
+	return size_t(count_if(errors, errors + rows,
+		[](unsigned char e) { return e != row_ok; }));
+}
+
+BatchResult
+EvaluateBatch(const Program& prog, const ColumnBindings& cols)
+{
+	BatchResult res;
+
+	res.values.resize(cols.Rows());
+	res.errors.resize(cols.Rows());
+	res.error_count
+		= EvaluateBatch(prog, cols, res.values.data(), res.errors.data());
+	return res;
+}
+
+}
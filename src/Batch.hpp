@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Program.hpp"
+
+namespace cxx
+{
+
+//! \brief 列式求值时每行的错误
+enum RowError : unsigned char
+{
+	row_ok = 0,
+	row_divide_by_zero = 1
+};
+
+/*!
+\brief 列式求值时变量的绑定
+\note 绑定了列的变量逐行取值，其它变量取 Environment 中的当前值，
+	过期的公式不重算。
+\note 只保存列的指针，列在求值期间必须保持有效且不少于 Rows() 行。
+*/
+class ColumnBindings
+{
+private:
+	const Environment& env;
+	size_t rows;
+	vector<const double*> columns;
+
+public:
+	ColumnBindings(const Environment& e, size_t n)
+		: env(e), rows(n), columns(e.SlotCount())
+	{}
+
+	void
+	Bind(string_view id, const vector<double>& col);
+	void
+	Bind(size_t slot, const double* col);
+	//! \brief 取 [first, first + n) 行的绑定
+	ColumnBindings
+	Slice(size_t first, size_t n) const;
+
+	const Environment&
+	GetEnvironment() const noexcept
+	{
+		return env;
+	}
+	size_t
+	Rows() const noexcept
+	{
+		return rows;
+	}
+	//! \brief 槽绑定的列，未绑定时为空指针
+	const double*
+	Column(size_t slot) const noexcept
+	{
+		return slot < columns.size() ? columns[slot] : nullptr;
+	}
+};
+
+struct BatchResult
+{
+	vector<double> values;
+	//! \brief 每行一个 RowError
+	vector<unsigned char> errors;
+	size_t error_count = 0;
+};
+
+/*!
+\brief 对每一行求程序中表达式的值
+\return 出错的行数
+\note 按块逐条执行指令，每条指令对整块数据做逐元素运算。
+\note 除数为零的行在 errors 中标记为 row_divide_by_zero ，值为 NaN ，
+	不影响其它行。
+\note 不执行定义或赋值。
+*/
+size_t
+EvaluateBatch(const Program& prog, const ColumnBindings& cols, double* out,
+	unsigned char* errors);
+
+BatchResult
+EvaluateBatch(const Program& prog, const ColumnBindings& cols);
+
+}
@@ -1,133 +1,254 @@
 #include "Chrono.hpp"
+#include <charconv>
+#include <cstring>
 
 namespace cxx
 {
 
-ostream&
-operator<<(ostream& os, Month m)
+namespace
 {
-	return os << static_cast<int>(m);
+
+// "00" to "99", for writing two digits at a time
+constexpr char digit_pairs[] = "00010203040506070809"
+							   "10111213141516171819"
+							   "20212223242526272829"
+							   "30313233343536373839"
+							   "40414243444546474849"
+							   "50515253545556575859"
+							   "60616263646566676869"
+							   "70717273747576777879"
+							   "80818283848586878889"
+							   "90919293949596979899";
+
+char*
+write2(char* p, int n) noexcept
+{
+	memcpy(p, digit_pairs + 2 * n, 2);
+	return p + 2;
 }
 
-// member function definitions:
-Date::Date(int yy, Month mm, int dd) : y{yy}, m{mm}, d{dd}
+// the 8 bytes at p, in memory order from the low byte
+uint64_t
+load8(const char* p) noexcept
 {
+	uint64_t x;
 
-	if(!is_date(yy, mm, dd))
-		throw Invalid{};
+	memcpy(&x, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	x = __builtin_bswap64(x);
+#endif
+	return x;
 }
 
-const Date&
-default_date()
+// Checks "YYYY-MM-" at once: the digit bytes must be 0x30 to 0x39 and the
+// others '-'. Adding 6 to a low nibble never carries out of its byte.
+bool
+is_iso_prefix(uint64_t x) noexcept
 {
-	static Date dd{2001, Month::jan, 1};
-	// start of 21st century
-	return dd;
+	constexpr uint64_t digits = 0x00FFFF00FFFFFFFF;
+	constexpr uint64_t dashes = 0x2D00002D00000000;
+	constexpr uint64_t ones = 0x0101010101010101;
+
+	return (x & ~digits) == dashes
+		&& (x & digits & ones * 0xF0) == (digits & ones * 0x30)
+		&& (((x & digits & ones * 0x0F) + (digits & ones * 0x06))
+			   & ones * 0xF0)
+		== 0;
 }
 
-Date::Date()
-	: y{default_date().year()}, m{default_date().month()},
-	  d{default_date().day()}
-{}
+int
+digit(char c) noexcept
+{
+	return c - '0';
+}
 
-void
-Date::add_day(int n)
+bool
+is_digit(char c) noexcept
 {
-	int days_in_month{31};
-	switch(m)
-	{
-	case Month::feb:
-		// the length of February varies
-		days_in_month = (leapyear(y)) ? 29 : 28;
-		break;
-	case Month::apr:
-	case Month::jun:
-	case Month::sep:
-	case Month::nov:
-		days_in_month = 30;
-		// the rest have 30 days
-		break;
-	}
+	return unsigned(c - '0') < 10;
+}
 
-	if(d + n > days_in_month)
-	{
-		d = d + n - days_in_month;
-	}
-	d += n;
+string_view
+trim(string_view s) noexcept
+{
+	while(!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+		s.remove_prefix(1);
+	while(!s.empty()
+		&& (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+		s.remove_suffix(1);
+	return s;
 }
 
-void
-Date::add_month(int n)
+date_error
+make_date(int y, int m, int d, Date& out) noexcept
 {
-	m = (static_cast<int>(m) + n > 12) ? Month(static_cast<int>(m) + n - 12)
-									   : Month(static_cast<int>(m) + n);
+	if(!is_date(y, Month(m), d))
+		return date_error::invalid;
+	out = Date(y, Month(m), d);
+	return date_error::ok;
 }
 
-void
-Date::add_year(int n)
+// [+-]YYYY+-MM-DD
+date_error
+parse_iso(string_view s, Date& out) noexcept
 {
-	if(m == Month::feb && d == 29 && !leapyear(y + n))
-	{ // beware of leap years!
-		m = Month::mar;
-		// use March 1 instead of February 29
-		d = 1;
+	if(s.size() == 10)
+	{
+		const uint64_t x = load8(s.data());
+
+		if(is_iso_prefix(x) && is_digit(s[8]) && is_digit(s[9]))
+			return make_date(digit(s[0]) * 1000 + digit(s[1]) * 100
+					+ digit(s[2]) * 10 + digit(s[3]),
+				digit(s[5]) * 10 + digit(s[6]), digit(s[8]) * 10 + digit(s[9]),
+				out);
+		return date_error::syntax;
 	}
-	y += n;
+	if(s.size() < 10)
+		return date_error::syntax;
+
+	// a longer year, which then must have a sign
+	const char* const last = s.data() + s.size();
+	const char* p = s.data();
+	const bool negative = *p == '-';
+
+	if((!negative && *p != '+') || !is_digit(*++p))
+		return date_error::syntax;
+
+	int y = 0;
+	const auto r = from_chars(p, last - 6, y);
+
+	if(r.ec == errc::result_out_of_range)
+		return date_error::invalid;
+	if(r.ec != errc() || r.ptr != last - 6 || r.ptr - p < 4)
+		return date_error::syntax;
+	p = r.ptr;
+	if(p[0] != '-' || p[3] != '-' || !is_digit(p[1]) || !is_digit(p[2])
+		|| !is_digit(p[4]) || !is_digit(p[5]))
+		return date_error::syntax;
+	return make_date(negative ? -y : y, digit(p[1]) * 10 + digit(p[2]),
+		digit(p[4]) * 10 + digit(p[5]), out);
 }
-// helper functions:
 
-bool
-is_date(int y, Month m, int d)
-{
-	// assume that y is valid
-	if(d <= 0)
-		return false;
-	// d must be positive
-	if(m < Month::jan || Month::dec < m)
-		return false;
-	int days_in_month{31};
-	// most months have 31 days
-	switch(m)
+// (y,m,d)
+date_error
+parse_tuple(string_view s, Date& out) noexcept
+{
+	if(s.size() < 7 || s.front() != '(' || s.back() != ')')
+		return date_error::syntax;
+
+	const char* const last = s.data() + s.size();
+	const char* p = s.data() + 1;
+	int f[3]{};
+
+	for(int i = 0; i != 3; ++i)
 	{
-	case Month::feb:
-		// the length of February varies
-		days_in_month = (leapyear(y)) ? 29 : 28;
-		break;
-	case Month::apr:
-	case Month::jun:
-	case Month::sep:
-	case Month::nov:
-		days_in_month = 30;
-		// the rest have 30 days
-		break;
+		const auto r = from_chars(p, last, f[i]);
+
+		if(r.ec == errc::result_out_of_range)
+			return date_error::invalid;
+		// the closing ')' is the last character
+		if(r.ec != errc() || *r.ptr != (i == 2 ? ')' : ',')
+			|| (i == 2) != (r.ptr + 1 == last))
+			return date_error::syntax;
+		p = r.ptr + 1;
 	}
-	if(days_in_month < d)
-		return false;
-	return true;
+	return make_date(f[0], f[1], f[2], out);
 }
 
-bool
-leapyear(int y)
+} // unnamed namespace;
+
+
+size_t
+parse_dates(string_view text, date_format fmt, vector<Date>& dates,
+	vector<date_error>& errors, char delimiter)
 {
-	return ((y % 4 == 0) && (y % 100 != 0)) || (y % 400 == 0);
+	size_t error_count = 0;
+
+	// ISO records take 11 bytes with their delimiter
+	dates.reserve(dates.size() + text.size() / 11 + 1);
+	errors.reserve(errors.size() + text.size() / 11 + 1);
+	while(!text.empty())
+	{
+		const auto pos = text.find(delimiter);
+		const auto record = trim(text.substr(0, pos));
+		Date d;
+		const auto e = fmt == date_format::iso ? parse_iso(record, d)
+											   : parse_tuple(record, d);
+
+		if(e != date_error::ok)
+		{
+			d = Date();
+			++error_count;
+		}
+		dates.push_back(d);
+		errors.push_back(e);
+		if(pos == string_view::npos)
+			break;
+		text.remove_prefix(pos + 1);
+	}
+	return error_count;
 }
 
-bool
-operator==(const Date& a, const Date& b)
+size_t
+format_dates(const Date* first, const Date* last, date_format fmt, char* out,
+	char delimiter) noexcept
 {
-	return a.year() == b.year() && a.month() == b.month() && a.day() == b.day();
+	char* p = out;
+
+	for(; first != last; ++first)
+	{
+		const int y = first->year();
+		const int m = static_cast<int>(first->month());
+		const int d = first->day();
+
+		if(fmt == date_format::iso)
+		{
+			if(0 <= y && y <= 9999)
+				p = write2(write2(p, y / 100), y % 100);
+			else
+			{
+				const unsigned u = y < 0 ? 0U - unsigned(y) : unsigned(y);
+
+				*p++ = y < 0 ? '-' : '+';
+				// at least 4 digits
+				for(unsigned k = 1000; k > 1 && u < k; k /= 10)
+					*p++ = '0';
+				p = to_chars(p, p + 8, u).ptr;
+			}
+			*p++ = '-';
+			p = write2(p, m);
+			*p++ = '-';
+			p = write2(p, d);
+		}
+		else
+		{
+			*p++ = '(';
+			p = to_chars(p, p + 8, y).ptr;
+			*p++ = ',';
+			p = to_chars(p, p + 2, m).ptr;
+			*p++ = ',';
+			p = to_chars(p, p + 2, d).ptr;
+			*p++ = ')';
+		}
+		*p++ = delimiter;
+	}
+	return size_t(p - out);
 }
 
-bool
-operator!=(const Date& a, const Date& b)
+ostream&
+operator<<(ostream& os, Month m)
 {
-	return !(a == b);
+	return os << static_cast<int>(m);
 }
 
 ostream&
 operator<<(ostream& os, const Date& d)
 {
-	return os << '(' << d.year() << ',' << d.month() << ',' << d.day() << ')';
+	char buf[max_date_chars + 1];
+	const size_t n = format_dates(&d, &d + 1, date_format::tuple, buf);
+
+	// without the delimiter
+	return os.write(buf, streamsize(n - 1));
 }
 
 istream&
@@ -149,22 +270,13 @@ operator>>(istream& is, Date& dd)
 	return is;
 }
 
-// Day
-// day_of_week(const Date& d)
-// {
-// 	// . . .
-// }
-
-// Date
-// next_Sunday(const Date& d)
-// {
-// 	// ...
-// }
-
-// Date
-// next_weekday(const Date& d)
-// {
-// 	// ...
-// }
+ostream&
+operator<<(ostream& os, Day d)
+{
+	static constexpr const char* names[]{"Sunday", "Monday", "Tuesday",
+		"Wednesday", "Thursday", "Friday", "Saturday"};
+
+	return os << names[static_cast<int>(d)];
+}
 
 } // Chrono
\ No newline at end of file
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <type_traits>
+#include "cxx/vector.hpp"
+
+using namespace std;
+
+namespace cxx
+{
+
+enum class Month
+{
+	jan = 1,
+	feb,
+	mar,
+	apr,
+	may,
+	jun,
+	jul,
+	aug,
+	sep,
+	oct,
+	nov,
+	dec
+};
+
+enum class Day
+{
+	sunday,
+	monday,
+	tuesday,
+	wednesday,
+	thursday,
+	friday,
+	saturday
+};
+
+//! \brief 公历闰年
+constexpr bool
+leapyear(int y) noexcept
+{
+	return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+//! \pre m 是有效的月份。
+constexpr int
+days_in_month(int y, Month m) noexcept
+{
+	// the table has no entry for February, which is checked first
+	constexpr unsigned char lengths[]{
+		31, 0, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+	return m == Month::feb ? (leapyear(y) ? 29 : 28)
+						   : lengths[static_cast<int>(m) - 1];
+}
+
+/*!
+\brief 计算公历日期的序列日数
+\pre m 是有效的月份， d 在 [1, 31] 中。
+\see http://howardhinnant.github.io/date_algorithms.html
+*/
+constexpr int
+days_from_civil(int y, Month m, int d) noexcept
+{
+	const int mm = static_cast<int>(m);
+
+	y -= mm <= 2;
+
+	const int era = (y >= 0 ? y : y - 399) / 400;
+	// [0, 399]
+	const int yoe = y - era * 400;
+	// [0, 365]
+	const int doy = (153 * (mm > 2 ? mm - 3 : mm + 9) + 2) / 5 + d - 1;
+	// [0, 146096]
+	const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
+/*!
+\brief 从序列日数计算公历日期
+\note 结果通过 y 、 m 和 d 返回。
+\see http://howardhinnant.github.io/date_algorithms.html
+*/
+constexpr void
+civil_from_days(int z, int& y, Month& m, int& d) noexcept
+{
+	z += 719468;
+
+	const int era = (z >= 0 ? z : z - 146096) / 146097;
+	// [0, 146096]
+	const int doe = z - era * 146097;
+	// [0, 399]
+	const int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	// [0, 365]
+	const int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	// [0, 11]
+	const int mp = (5 * doy + 2) / 153;
+	const int mm = mp < 10 ? mp + 3 : mp - 9;
+
+	d = doy - (153 * mp + 2) / 5 + 1;
+	m = Month(mm);
+	y = yoe + era * 400 + (mm <= 2);
+}
+
+//! \brief 序列日数对应的星期
+constexpr Day
+weekday_from_days(int z) noexcept
+{
+	// 1970-01-01 is a Thursday
+	return Day(z >= -4 ? (z + 4) % 7 : (z + 5) % 7 + 6);
+}
+
+//! \brief Date 可以表示的年份范围
+constexpr int min_year = -(1 << 22);
+constexpr int max_year = (1 << 22) - 1;
+
+constexpr bool
+is_date(int y, Month m, int d) noexcept
+{
+	return min_year <= y && y <= max_year && Month::jan <= m
+		&& m <= Month::dec && 0 < d && d <= days_in_month(y, m);
+}
+
+/*!
+\brief 公历日期
+\note 可以和序列日数相互转换，序列日数是从 1970-01-01 起的天数，
+	之前的日期为负数；日期的加减和星期都通过序列日数在常数时间内计算。
+\note 年、月和日压缩在一个 32 位整数中，依次占 23 、 4 和 5 位，
+	整数的大小顺序就是日期的先后顺序。
+\note 所有操作都是 constexpr ，类型可平凡复制。
+	结果超出 [min_year, max_year] 时行为未定义。
+*/
+class Date
+{
+public:
+	//! \brief 用于抛出异常
+	class Invalid
+	{};
+
+private:
+	int32_t rep;
+
+	struct packed_tag
+	{};
+
+	constexpr Date(packed_tag, int y, Month m, int d) noexcept
+		: rep(y * 512 + static_cast<int>(m) * 32 + d)
+	{}
+
+public:
+	//! \brief 检查日期并初始化
+	constexpr Date(int y, Month m, int d)
+		: rep(is_date(y, m, d) ? Date(packed_tag(), y, m, d).rep
+							   : throw Invalid{})
+	{}
+	//! \brief 默认日期： 21 世纪的第一天
+	constexpr Date() noexcept : Date(packed_tag(), 2001, Month::jan, 1)
+	{}
+	//! \brief 从序列日数初始化
+	explicit constexpr Date(int serial) noexcept : rep(0)
+	{
+		int y = 0, d = 0;
+		Month m{};
+
+		civil_from_days(serial, y, m, d);
+		rep = Date(packed_tag(), y, m, d).rep;
+	}
+
+	// 不修改的操作：
+	constexpr int
+	day() const noexcept
+	{
+		return rep & 31;
+	}
+	constexpr Month
+	month() const noexcept
+	{
+		return Month((rep >> 5) & 15);
+	}
+	constexpr int
+	year() const noexcept
+	{
+		return rep >> 9;
+	}
+	//! \brief 序列日数
+	constexpr int
+	days() const noexcept
+	{
+		return days_from_civil(year(), month(), day());
+	}
+	//! \brief 压缩的表示，顺序和日期相同
+	constexpr int32_t
+	packed() const noexcept
+	{
+		return rep;
+	}
+
+	// 修改的操作：
+	//! \brief 加上 n 天， n 可以为负数
+	constexpr void
+	add_day(int n) noexcept
+	{
+		*this = Date(days() + n);
+	}
+	/*!
+	\brief 加上 n 个月，向年进位或借位
+	\note 新的月份没有原来的日时，使用下个月的第一天，例如 1 月 31 日
+		加上 1 个月为 3 月 1 日。
+	*/
+	constexpr void
+	add_month(int n) noexcept
+	{
+		// months since year 0, so that the carry is a floor division
+		const int months = year() * 12 + static_cast<int>(month()) - 1 + n;
+		const int y = (months >= 0 ? months : months - 11) / 12;
+		const auto m = Month(months - y * 12 + 1);
+
+		if(day() > days_in_month(y, m))
+		{ // the day does not exist in the new month: use the 1st of the next
+			*this = Date(packed_tag(), y, m, 1);
+			add_month(1);
+		}
+		else
+			*this = Date(packed_tag(), y, m, day());
+	}
+	//! \note 2 月 29 日在新的年份不是闰年时使用 3 月 1 日。
+	constexpr void
+	add_year(int n) noexcept
+	{
+		if(month() == Month::feb && day() == 29 && !leapyear(year() + n))
+			// beware of leap years! use March 1 instead of February 29
+			*this = Date(packed_tag(), year() + n, Month::mar, 1);
+		else
+			*this = Date(packed_tag(), year() + n, month(), day());
+	}
+};
+
+static_assert(sizeof(Date) == 4, "Date should be packed in 4 bytes.");
+static_assert(is_trivially_copyable<Date>::value,
+	"Date should be trivially copyable.");
+
+constexpr Date
+default_date() noexcept
+{
+	return Date();
+}
+
+constexpr bool
+operator==(const Date& a, const Date& b) noexcept
+{
+	return a.packed() == b.packed();
+}
+constexpr bool
+operator!=(const Date& a, const Date& b) noexcept
+{
+	return !(a == b);
+}
+constexpr bool
+operator<(const Date& a, const Date& b) noexcept
+{
+	return a.packed() < b.packed();
+}
+
+//! \brief 相差的天数
+constexpr int
+operator-(const Date& a, const Date& b) noexcept
+{
+	return a.days() - b.days();
+}
+
+ostream&
+operator<<(ostream& os, Month m);
+ostream&
+operator<<(ostream& os, Day d);
+ostream&
+operator<<(ostream& os, const Date& d);
+
+istream&
+operator>>(istream& is, Date& dd);
+
+constexpr Day
+day_of_week(const Date& d) noexcept
+{
+	return weekday_from_days(d.days());
+}
+//! \brief d 之后的第一个星期日
+constexpr Date
+next_Sunday(const Date& d) noexcept
+{
+	return Date(d.days() + 7 - static_cast<int>(day_of_week(d)));
+}
+//! \brief d 之后的第一个工作日（星期一到星期五）
+constexpr Date
+next_weekday(const Date& d) noexcept
+{
+	return Date(d.days()
+		+ (day_of_week(d) == Day::friday
+				? 3
+				: day_of_week(d) == Day::saturday ? 2 : 1));
+}
+
+//! \brief 批量解析和格式化的日期格式
+enum class date_format : unsigned char
+{
+	//! \brief ISO 8601 的 YYYY-MM-DD ；不在 [0, 9999] 中的年份带符号且至少 4 位
+	iso,
+	//! \brief 和 operator<< 相同的 (y,m,d)
+	tuple
+};
+
+//! \brief 每条记录的解析结果
+enum class date_error : unsigned char
+{
+	ok,
+	//! \brief 不符合格式
+	syntax,
+	//! \brief 符合格式但不是有效的日期
+	invalid
+};
+
+//! \brief 格式化一个日期最多需要的字符数，不含分隔符
+constexpr size_t max_date_chars = 16;
+
+/*!
+\brief 批量解析日期
+\param text 以 delimiter 分隔的记录，最后一条记录之后的分隔符可以省略
+\return 出错的记录数
+\note 每条记录向 dates 和 errors 各追加一项，出错的记录的日期为 Date() 。
+	记录两端的空格、制表符和 '\r' 被忽略。
+\note 不抛出格式错误的异常。 ISO 格式的常见情形（4 位年份）在一个 64 位字中
+	同时检查 8 个字符。
+*/
+size_t
+parse_dates(string_view text, date_format fmt, vector<Date>& dates,
+	vector<date_error>& errors, char delimiter = '\n');
+
+/*!
+\brief 批量格式化日期
+\pre out 至少有 (last - first) * (max_date_chars + 1) 个字符的空间。
+\return 写入的字符数
+\note 每个日期之后写入 delimiter 。
+*/
+size_t
+format_dates(const Date* first, const Date* last, date_format fmt, char* out,
+	char delimiter = '\n') noexcept;
+
+} // Chrono.
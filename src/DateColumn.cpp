@@ -0,0 +1,366 @@
+#include "DateColumn.hpp"
+#include <algorithm>
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#	define CXX_DATE_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#	include <emmintrin.h>
+#	define CXX_DATE_SIMD 1
+#endif
+
+namespace cxx
+{
+
+namespace
+{
+
+// Whole 400-year eras added to every serial day so that the civil
+// computation below only sees non-negative values, which keeps it free of
+// branches and lets the compiler vectorize the loops over a column.
+constexpr uint32_t era_days = 146097;
+constexpr uint32_t era_bias = 10500;
+constexpr uint32_t day_bias = 719468 + era_days * era_bias;
+// whole weeks added for the same reason
+constexpr uint32_t week_bias = 220000000;
+
+static_assert(uint64_t(day_bias) * 2 < uint64_t(1) << 32,
+	"Biased serial days should fit in 32 bits.");
+
+struct civil
+{
+	int32_t y;
+	int32_t m;
+	int32_t d;
+};
+
+inline civil
+civil_from_serial(int32_t z) noexcept
+{
+	const uint32_t zb = uint32_t(z) + day_bias;
+	const uint32_t era = zb / era_days;
+	const uint32_t doe = zb - era * era_days;
+	const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const uint32_t mp = (5 * doy + 2) / 153;
+	const uint32_t m = mp < 10 ? mp + 3 : mp - 9;
+
+	return {int32_t(yoe + era * 400 + (m <= 2)) - int32_t(era_bias * 400),
+		int32_t(m), int32_t(doy - (153 * mp + 2) / 5 + 1)};
+}
+
+#if defined(__AVX2__)
+struct simd
+{
+	using pack = __m256i;
+	static constexpr size_t width = 8;
+
+	static pack
+	load(const int32_t* p)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const pack*>(p));
+	}
+	static pack
+	set1(uint32_t x)
+	{
+		return _mm256_set1_epi32(int(x));
+	}
+	static pack
+	sub(pack x, pack y)
+	{
+		return _mm256_sub_epi32(x, y);
+	}
+	static pack
+	greater(pack x, pack y)
+	{
+		return _mm256_cmpgt_epi32(x, y);
+	}
+	static pack
+	bit_xor(pack x, pack y)
+	{
+		return _mm256_xor_si256(x, y);
+	}
+	static unsigned
+	bits(pack mask)
+	{
+		return unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+	}
+};
+#elif CXX_DATE_SIMD
+struct simd
+{
+	using pack = __m128i;
+	static constexpr size_t width = 4;
+
+	static pack
+	load(const int32_t* p)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const pack*>(p));
+	}
+	static pack
+	set1(uint32_t x)
+	{
+		return _mm_set1_epi32(int(x));
+	}
+	static pack
+	sub(pack x, pack y)
+	{
+		return _mm_sub_epi32(x, y);
+	}
+	static pack
+	greater(pack x, pack y)
+	{
+		return _mm_cmpgt_epi32(x, y);
+	}
+	static pack
+	bit_xor(pack x, pack y)
+	{
+		return _mm_xor_si128(x, y);
+	}
+	static unsigned
+	bits(pack mask)
+	{
+		return unsigned(_mm_movemask_ps(_mm_castsi128_ps(mask)));
+	}
+};
+#endif
+
+// lo <= z <= hi as one unsigned compare: z - lo <= hi - lo
+uint64_t
+scalar_word(const int32_t* p, size_t n, uint32_t lo, uint32_t span) noexcept
+{
+	uint64_t w = 0;
+
+	for(size_t i = 0; i != n; ++i)
+		w |= uint64_t(uint32_t(p[i]) - lo <= span) << i;
+	return w;
+}
+
+#if CXX_DATE_SIMD
+// The unsigned compare of scalar_word, done on signed lanes by flipping the
+// sign bits: z - lo > hi - lo marks the rows outside the range.
+uint64_t
+simd_word(const int32_t* p, uint32_t lo, uint32_t span) noexcept
+{
+	const auto sign = simd::set1(0x80000000U);
+	const auto vlo = simd::set1(lo);
+	const auto bound = simd::set1(span ^ 0x80000000U);
+	uint64_t outside = 0;
+
+	for(size_t i = 0; i != 64; i += simd::width)
+		outside |= uint64_t(simd::bits(simd::greater(
+					   simd::bit_xor(simd::sub(simd::load(p + i), vlo), sign),
+					   bound)))
+			<< i;
+	return ~outside;
+}
+#endif
+
+void
+month_keys_of(const int32_t* p, size_t n, int32_t* out) noexcept
+{
+	for(size_t i = 0; i != n; ++i)
+	{
+		const civil c = civil_from_serial(p[i]);
+
+		out[i] = (c.y - 1970) * 12 + c.m - 1;
+	}
+}
+
+void
+week_keys_of(const int32_t* p, size_t n, int32_t* out) noexcept
+{
+	// 1969-12-29, the Monday starting week 0, is serial day -3
+	for(size_t i = 0; i != n; ++i)
+		out[i] = int32_t((uint32_t(p[i]) + 3 + 7 * week_bias) / 7)
+			- int32_t(week_bias);
+}
+
+// rows whose keys are computed together while grouping
+constexpr size_t group_block = 1024;
+
+// Counts the rows of each key in key order. Keys grow with the date, so
+// their range follows from the earliest and latest dates. A dense range is
+// counted in a histogram, block by block without storing the keys; a
+// sparse one sorts all the keys.
+template<typename _fKeys, typename _fFirst>
+vector<date_group>
+group_keys(const int32_t* p, size_t n, _fKeys keys_of, _fFirst first_day)
+{
+	vector<date_group> groups;
+
+	if(n == 0)
+		return groups;
+
+	int32_t bounds[2]{p[0], p[0]};
+
+	for(size_t i = 1; i != n; ++i)
+	{
+		bounds[0] = min(bounds[0], p[i]);
+		bounds[1] = max(bounds[1], p[i]);
+	}
+	keys_of(bounds, 2, bounds);
+
+	const int32_t lo = bounds[0];
+	const size_t range = size_t(int64_t(bounds[1]) - lo) + 1;
+
+	if(range <= n * 2 + 1024)
+	{
+		vector<size_t> counts(range);
+		int32_t block[group_block];
+
+		for(size_t i = 0; i < n; i += group_block)
+		{
+			const size_t m = min(group_block, n - i);
+
+			keys_of(p + i, m, block);
+			for(size_t j = 0; j != m; ++j)
+				++counts[size_t(block[j] - lo)];
+		}
+		for(size_t i = 0; i != range; ++i)
+			if(counts[i] != 0)
+				groups.push_back({first_day(lo + int32_t(i)), counts[i]});
+	}
+	else
+	{
+		vector<int32_t> keys(n);
+
+		keys_of(p, n, keys.data());
+		sort(keys.begin(), keys.end());
+		for(size_t i = 0; i != n;)
+		{
+			size_t j = i + 1;
+
+			while(j != n && keys[j] == keys[i])
+				++j;
+			groups.push_back({first_day(keys[i]), j - i});
+			i = j;
+		}
+	}
+	return groups;
+}
+
+} // unnamed namespace;
+
+
+date_column::date_column(const Date* first, const Date* last)
+{
+	serials.reserve(size_t(last - first));
+	for(; first != last; ++first)
+		serials.push_back(first->days());
+}
+
+size_t
+date_column::filter_between(Date lo, Date hi, uint64_t* bitmap) const noexcept
+{
+	const size_t n = serials.size();
+	const int32_t* p = serials.data();
+	size_t count = 0;
+
+	if(hi < lo)
+	{
+		fill_n(bitmap, bitmap_words(n), 0);
+		return 0;
+	}
+
+	const auto vlo = uint32_t(lo.days());
+	const auto span = uint32_t(hi.days()) - vlo;
+	size_t i = 0;
+
+	for(; i + 64 <= n; i += 64)
+	{
+#if CXX_DATE_SIMD
+		const uint64_t w = simd_word(p + i, vlo, span);
+#else
+		const uint64_t w = scalar_word(p + i, 64, vlo, span);
+#endif
+
+		bitmap[i / 64] = w;
+		count += size_t(__builtin_popcountll(w));
+	}
+	if(i != n)
+	{
+		const uint64_t w = scalar_word(p + i, n - i, vlo, span);
+
+		bitmap[i / 64] = w;
+		count += size_t(__builtin_popcountll(w));
+	}
+	return count;
+}
+
+vector<uint64_t>
+date_column::between(Date lo, Date hi) const
+{
+	vector<uint64_t> bitmap(bitmap_words(serials.size()));
+
+	filter_between(lo, hi, bitmap.data());
+	return bitmap;
+}
+
+void
+date_column::years(int32_t* out) const noexcept
+{
+	const int32_t* p = serials.data();
+
+	for(size_t i = 0, n = serials.size(); i != n; ++i)
+		out[i] = civil_from_serial(p[i]).y;
+}
+
+void
+date_column::months(int32_t* out) const noexcept
+{
+	const int32_t* p = serials.data();
+
+	for(size_t i = 0, n = serials.size(); i != n; ++i)
+		out[i] = civil_from_serial(p[i]).m;
+}
+
+void
+date_column::days_of_month(int32_t* out) const noexcept
+{
+	const int32_t* p = serials.data();
+
+	for(size_t i = 0, n = serials.size(); i != n; ++i)
+		out[i] = civil_from_serial(p[i]).d;
+}
+
+void
+date_column::weekdays(int32_t* out) const noexcept
+{
+	const int32_t* p = serials.data();
+
+	// 1970-01-01 is a Thursday
+	for(size_t i = 0, n = serials.size(); i != n; ++i)
+		out[i] = int32_t((uint32_t(p[i]) + 4 + 7 * week_bias) % 7);
+}
+
+void
+date_column::month_keys(int32_t* out) const noexcept
+{
+	month_keys_of(serials.data(), serials.size(), out);
+}
+
+void
+date_column::week_keys(int32_t* out) const noexcept
+{
+	week_keys_of(serials.data(), serials.size(), out);
+}
+
+vector<date_group>
+date_column::group_by_month() const
+{
+	return group_keys(serials.data(), serials.size(), month_keys_of,
+		[](int32_t k) {
+			const int32_t y = (k >= 0 ? k : k - 11) / 12;
+
+			return Date(1970 + y, Month(k - y * 12 + 1), 1);
+		});
+}
+
+vector<date_group>
+date_column::group_by_week() const
+{
+	return group_keys(serials.data(), serials.size(), week_keys_of,
+		[](int32_t k) { return Date(k * 7 - 3); });
+}
+
+}
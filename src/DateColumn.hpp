@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Chrono.hpp"
+
+namespace cxx
+{
+
+//! \brief 分组的结果
+struct date_group
+{
+	//! \brief 分组的第一天：月的 1 日或周的星期一
+	Date first;
+	size_t count;
+};
+
+//! \brief 保存 n 行的位图需要的 64 位字数
+constexpr size_t
+bitmap_words(size_t n) noexcept
+{
+	return (n + 63) / 64;
+}
+
+/*!
+\brief 日期列
+\note 日期按序列日数连续保存，比较和范围查询直接在整数上进行。
+\note 范围查询的结果是位图：第 i 行对应第 i / 64 个字的第 i % 64 位。
+\note 字段提取和分组键的计算每次处理一整列，结果写入调用者提供的数组，
+	至少需要 size() 个元素。
+*/
+class date_column
+{
+private:
+	vector<int32_t> serials;
+
+public:
+	date_column() = default;
+	date_column(const Date* first, const Date* last);
+
+	size_t
+	size() const noexcept
+	{
+		return serials.size();
+	}
+	bool
+	empty() const noexcept
+	{
+		return serials.empty();
+	}
+	void
+	reserve(size_t n)
+	{
+		serials.reserve(n);
+	}
+	void
+	push_back(Date d)
+	{
+		serials.push_back(d.days());
+	}
+	Date
+	operator[](size_t i) const noexcept
+	{
+		return Date(serials[i]);
+	}
+	//! \brief 按行排列的序列日数
+	const int32_t*
+	data() const noexcept
+	{
+		return serials.data();
+	}
+
+	/*!
+	\brief 标记 lo <= 日期 <= hi 的行
+	\pre bitmap 至少有 bitmap_words(size()) 个字。
+	\return 标记的行数
+	\note 最后一个字中超出 size() 的位为 0 。
+	*/
+	size_t
+	filter_between(Date lo, Date hi, uint64_t* bitmap) const noexcept;
+	vector<uint64_t>
+	between(Date lo, Date hi) const;
+
+	void
+	years(int32_t* out) const noexcept;
+	//! \brief 月份， 1 到 12
+	void
+	months(int32_t* out) const noexcept;
+	//! \brief 月中的日， 1 到 31
+	void
+	days_of_month(int32_t* out) const noexcept;
+	//! \brief 星期，按 Day 的值，星期日为 0
+	void
+	weekdays(int32_t* out) const noexcept;
+
+	//! \brief 月的编号：从 1970 年 1 月起的月数
+	void
+	month_keys(int32_t* out) const noexcept;
+	//! \brief 周的编号：从 1969-12-29 （星期一）起的周数
+	void
+	week_keys(int32_t* out) const noexcept;
+
+	//! \brief 按月分组计数，按时间顺序，不含空的分组
+	vector<date_group>
+	group_by_month() const;
+	//! \brief 按周（星期一到星期日）分组计数，按时间顺序，不含空的分组
+	vector<date_group>
+	group_by_week() const;
+};
+
+}
@@ -0,0 +1,107 @@
+#include "Driver.hpp"
+#include "cxx/thread_pool.hpp"
+#include <atomic>
+
+namespace cxx
+{
+
+namespace
+{
+
+// statements or rows handed to a worker at a time
+constexpr size_t statement_chunk = 64;
+constexpr size_t row_chunk = 16384;
+
+unsigned
+worker_count(unsigned threads, size_t chunks)
+{
+	if(threads == 0)
+		threads = thread_pool::shared().size() + 1;
+	return unsigned(min<size_t>(threads, max<size_t>(chunks, 1)));
+}
+
+// Run work(chunk) for every chunk in [0, chunks) on the calling thread and
+// the workers of the shared pool. Chunks are claimed from a shared counter so
+// that slow chunks do not hold up a whole static shard. The first exception
+// is rethrown.
+template<class _fWork>
+void
+run_chunks(size_t chunks, unsigned threads, _fWork work)
+{
+	thread_pool::shared().run_chunks(
+		chunks, threads, [&](size_t i, unsigned) { work(i); });
+}
+
+} // unnamed namespace;
+
+
+vector<StatementResult>
+RunStatements(string_view script, const Environment& env, unsigned threads)
+{
+	Token_buffer tokens(script);
+
+	// statements compiled against unmodified snapshots of env find their
+	// variables by identifier id
+	tokens.Resolve(env);
+
+	const auto& toks = tokens.Tokens();
+	// token ranges of the non-empty statements, without their terminators
+	vector<pair<size_t, size_t>> spans;
+	size_t start = 0;
+
+	for(size_t i = 0; i != toks.size(); ++i)
+		if(toks[i].kind == print || toks[i].kind == exit)
+		{
+			if(i != start)
+				spans.emplace_back(start, i);
+			start = i + 1;
+		}
+
+	const size_t n = spans.size();
+	const size_t chunks = (n + statement_chunk - 1) / statement_chunk;
+	vector<StatementResult> results(n);
+
+	run_chunks(chunks, worker_count(threads, chunks), [&](size_t c) {
+		const size_t last = min(n, (c + 1) * statement_chunk);
+
+		for(size_t i = c * statement_chunk; i != last; ++i)
+		{
+			Environment snapshot(env);
+			Token_cursor ts(tokens, spans[i].first, spans[i].second);
+
+			try
+			{
+				const auto prog = Compile(ts, snapshot);
+
+				if(!ts.empty())
+					throw runtime_error("';' expected");
+				results[i].value = prog.Run(snapshot);
+			}
+			catch(exception& e)
+			{
+				results[i].error = e.what();
+			}
+		}
+	});
+	return results;
+}
+
+size_t
+EvaluateParallel(const Program& prog, const ColumnBindings& cols, double* out,
+	unsigned char* errors, unsigned threads)
+{
+	const size_t rows = cols.Rows();
+	const size_t chunks = (rows + row_chunk - 1) / row_chunk;
+	atomic<size_t> error_count{0};
+
+	run_chunks(chunks, worker_count(threads, chunks), [&](size_t c) {
+		const size_t first = c * row_chunk;
+
+		error_count += EvaluateBatch(prog,
+			cols.Slice(first, min(row_chunk, rows - first)), out + first,
+			errors + first);
+	});
+	return error_count;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Batch.hpp"
+
+namespace cxx
+{
+
+struct StatementResult
+{
+	double value = 0;
+	//! \brief 出错时的错误信息，成功时为空
+	string error;
+};
+
+/*!
+\brief 并行执行一组互相独立的语句
+\param script 以 ';' 分隔的语句
+\param threads 工作线程数（含调用线程），为 0 时取共享线程池的线程数加 1
+\return 按输入顺序排列的每条语句的结果
+\note 每条语句在 env 的写时复制快照上编译和执行，语句中的定义和赋值
+	只影响自己的快照，不影响 env 和其它语句。
+\note 语句按块动态分配给调用线程和 thread_pool::shared() 的工作线程。
+*/
+vector<StatementResult>
+RunStatements(string_view script, const Environment& env, unsigned threads = 0);
+
+/*!
+\brief 并行地对每一行求程序中表达式的值
+\return 出错的行数
+\note 行按块分配给调用线程和共享线程池的工作线程，每块由 EvaluateBatch 求值；
+	结果和错误标记写入 out 和 errors 中对应的行。
+*/
+size_t
+EvaluateParallel(const Program& prog, const ColumnBindings& cols, double* out,
+	unsigned char* errors, unsigned threads = 0);
+
+}
@@ -0,0 +1,422 @@
+#include "Jit.hpp"
+#include <cstring>
+#if defined(__x86_64__) && defined(__linux__)
+#	include <sys/mman.h>
+#	define CXX_JIT 1
+#endif
+
+namespace cxx
+{
+
+namespace
+{
+
+// rows per call of the batch code; a multiple of the 4 rows per iteration
+constexpr size_t jit_block_rows = 256;
+
+#if CXX_JIT
+// registers holding the evaluation stack; the last two are scratch
+constexpr size_t stack_registers = 14;
+constexpr unsigned scratch_a = 14;
+constexpr unsigned scratch_b = 15;
+
+enum Gpr : unsigned
+{
+	rax = 0,
+	rcx = 1,
+	rdx = 2,
+	rsi = 6,
+	rdi = 7
+};
+
+// Just the encodings the two code generators need. Memory operands are
+// always [base + disp32] with a base that needs no SIB byte.
+class Assembler
+{
+public:
+	vector<unsigned char> code;
+
+	void
+	byte(unsigned b)
+	{
+		code.push_back(static_cast<unsigned char>(b));
+	}
+	void
+	bytes(std::initializer_list<unsigned> bs)
+	{
+		for(const auto b : bs)
+			byte(b);
+	}
+	void
+	dword(uint32_t d)
+	{
+		for(int i = 0; i < 4; ++i)
+			byte((d >> (8 * i)) & 0xFF);
+	}
+
+	// legacy SSE: prefix [REX] 0F op with a register operand
+	void
+	sse_rr(unsigned prefix, unsigned op, unsigned reg, unsigned rm)
+	{
+		byte(prefix);
+		if((reg | rm) & 8)
+			byte(0x40 | (reg >> 3) << 2 | rm >> 3);
+		bytes({0x0F, op, 0xC0 | (reg & 7) << 3 | (rm & 7)});
+	}
+	// legacy SSE: prefix [REX] 0F op with a [base + disp32] operand
+	void
+	sse_rm(unsigned prefix, unsigned op, unsigned reg, Gpr base, size_t disp)
+	{
+		byte(prefix);
+		if(reg & 8)
+			byte(0x44);
+		bytes({0x0F, op, 0x80 | (reg & 7) << 3 | base});
+		dword(uint32_t(disp));
+	}
+
+	// three-byte VEX, 256-bit, 66 prefix; map 1 = 0F, 2 = 0F38, 3 = 0F3A
+	void
+	vex(unsigned map, unsigned reg, unsigned vvvv, unsigned b)
+	{
+		bytes({0xC4, ((~reg >> 3) & 1) << 7 | 1 << 6 | ((~b >> 3) & 1) << 5 | map,
+			(~vvvv & 15) << 3 | 1 << 2 | 1});
+	}
+	void
+	vex_rr(unsigned map, unsigned op, unsigned reg, unsigned vvvv, unsigned rm)
+	{
+		vex(map, reg, vvvv, rm);
+		bytes({op, 0xC0 | (reg & 7) << 3 | (rm & 7)});
+	}
+	void
+	vex_rm(unsigned map, unsigned op, unsigned reg, Gpr base, size_t disp)
+	{
+		vex(map, reg, 0, 0);
+		bytes({op, 0x80 | (reg & 7) << 3 | base});
+		dword(uint32_t(disp));
+	}
+};
+
+// SSE2 and AVX opcodes of the arithmetic operations
+unsigned
+arith_opcode(Opcode op)
+{
+	switch(op)
+	{
+	case Opcode::add:
+		return 0x58;
+	case Opcode::multiply:
+		return 0x59;
+	case Opcode::subtract:
+		return 0x5C;
+	default:
+		return 0x5E;
+	}
+}
+
+// Checks that every instruction has a native form and the stack fits in
+// the registers.
+bool
+is_supported(const Program& prog)
+{
+	if(prog.StackDepth() > stack_registers || prog.Code().empty())
+		return false;
+	for(const auto& ins : prog.Code())
+		if(ins.op == Opcode::modulo)
+			return false;
+	return true;
+}
+
+// int f(const double* vars, const double* consts, double* temps,
+//	double* result)
+// Returns 0 with the value in *result, or 1 on a zero divisor.
+vector<unsigned char>
+generate_scalar(const Program& prog, size_t sign_index)
+{
+	Assembler a;
+	unsigned d = 0;
+
+	for(const auto& ins : prog.Code())
+		switch(ins.op)
+		{
+		case Opcode::constant: // movsd xmm(d), [rsi + 8k]
+			a.sse_rm(0xF2, 0x10, d++, rsi, 8 * ins.operand);
+			break;
+		case Opcode::load: // movsd xmm(d), [rdi + 8s]
+			a.sse_rm(0xF2, 0x10, d++, rdi, 8 * ins.operand);
+			break;
+		case Opcode::reuse: // movsd xmm(d), [rdx + 8t]
+			a.sse_rm(0xF2, 0x10, d++, rdx, 8 * ins.operand);
+			break;
+		case Opcode::store: // movsd [rdx + 8t], xmm(d - 1)
+			a.sse_rm(0xF2, 0x11, d - 1, rdx, 8 * ins.operand);
+			break;
+		case Opcode::negate: // xorpd with the sign mask
+			a.sse_rm(0xF2, 0x10, scratch_a, rsi, 8 * sign_index);
+			a.sse_rr(0x66, 0x57, d - 1, scratch_a);
+			break;
+		case Opcode::divide:
+			// xorpd xmm15, xmm15; ucomisd xmm(d - 1), xmm15; jp ok; jne ok;
+			// mov eax, 1; ret; ok:
+			a.sse_rr(0x66, 0x57, scratch_b, scratch_b);
+			a.sse_rr(0x66, 0x2E, d - 1, scratch_b);
+			a.bytes({0x7A, 0x08, 0x75, 0x06, 0xB8});
+			a.dword(1);
+			a.byte(0xC3);
+			[[fallthrough]];
+		default:
+			a.sse_rr(0xF2, arith_opcode(ins.op), d - 2, d - 1);
+			--d;
+		}
+	// movsd [rcx], xmm0; xor eax, eax; ret
+	a.sse_rm(0xF2, 0x11, 0, rcx, 0);
+	a.bytes({0x31, 0xC0, 0xC3});
+	return std::move(a.code);
+}
+
+// void f(const double* const* inputs, const double* consts, double* temps,
+//	double* out, unsigned char* masks, size_t bytes)
+// Evaluates 4 rows per iteration. inputs[s] points to the rows of slot s;
+// temps holds 4 doubles per temporary. For each zero divisor the bits of
+// the affected rows are ORed into masks[row / 4].
+vector<unsigned char>
+generate_batch(const Program& prog, size_t sign_index, size_t nan_index)
+{
+	Assembler a;
+	unsigned d = 0;
+
+	// xor r10d, r10d; mov r11, r8
+	a.bytes({0x45, 0x31, 0xD2, 0x4D, 0x89, 0xC3});
+
+	const size_t loop = a.code.size();
+
+	for(const auto& ins : prog.Code())
+		switch(ins.op)
+		{
+		case Opcode::constant: // vbroadcastsd ymm(d), [rsi + 8k]
+			a.vex_rm(2, 0x19, d++, rsi, 8 * ins.operand);
+			break;
+		case Opcode::load:
+			// mov rax, [rdi + 8s]; add rax, r10; vmovupd ymm(d), [rax]
+			a.bytes({0x48, 0x8B, 0x87});
+			a.dword(uint32_t(8 * ins.operand));
+			a.bytes({0x4C, 0x01, 0xD0});
+			a.vex_rm(1, 0x10, d++, rax, 0);
+			break;
+		case Opcode::reuse: // vmovupd ymm(d), [rdx + 32t]
+			a.vex_rm(1, 0x10, d++, rdx, 32 * ins.operand);
+			break;
+		case Opcode::store: // vmovupd [rdx + 32t], ymm(d - 1)
+			a.vex_rm(1, 0x11, d - 1, rdx, 32 * ins.operand);
+			break;
+		case Opcode::negate:
+			a.vex_rm(2, 0x19, scratch_a, rsi, 8 * sign_index);
+			a.vex_rr(1, 0x57, d - 1, d - 1, scratch_a);
+			break;
+		case Opcode::divide:
+			// vxorpd ymm15, ymm15, ymm15; vcmpeqpd ymm15, ymm(d - 1), ymm15;
+			// vmovmskpd eax, ymm15; or [r11], al
+			a.vex_rr(1, 0x57, scratch_b, scratch_b, scratch_b);
+			a.vex_rr(1, 0xC2, scratch_b, d - 1, scratch_b);
+			a.byte(0);
+			a.vex_rr(1, 0x50, rax, 0, scratch_b);
+			a.bytes({0x41, 0x08, 0x03});
+			// vdivpd, then vblendvpd ymm(d - 2), ymm(d - 2), NaN, ymm15
+			a.vex_rr(1, 0x5E, d - 2, d - 2, d - 1);
+			a.vex_rm(2, 0x19, scratch_a, rsi, 8 * nan_index);
+			a.vex_rr(3, 0x4B, d - 2, d - 2, scratch_a);
+			a.byte(scratch_b << 4);
+			--d;
+			break;
+		default:
+			a.vex_rr(1, arith_opcode(ins.op), d - 2, d - 2, d - 1);
+			--d;
+		}
+	// mov rax, rcx; add rax, r10; vmovupd [rax], ymm0
+	a.bytes({0x48, 0x89, 0xC8, 0x4C, 0x01, 0xD0});
+	a.vex_rm(1, 0x11, 0, rax, 0);
+	// add r10, 32; inc r11; cmp r10, r9; jb loop
+	a.bytes({0x49, 0x83, 0xC2, 0x20, 0x49, 0xFF, 0xC3, 0x4D, 0x39, 0xCA});
+	a.bytes({0x0F, 0x82});
+	a.dword(uint32_t(int32_t(loop - (a.code.size() + 4))));
+	// vzeroupper; ret
+	a.bytes({0xC5, 0xF8, 0x77, 0xC3});
+	return std::move(a.code);
+}
+#endif
+
+} // unnamed namespace;
+
+
+JitProgram::JitProgram(const Program& prog)
+	: temp_count(prog.TempCount()), constants(prog.Constants())
+{
+#if CXX_JIT
+	if(!is_supported(prog))
+		return;
+
+	const size_t sign_index = constants.size();
+	const size_t nan_index = sign_index + 1;
+
+	constants.push_back(-0.0);
+	constants.push_back(numeric_limits<double>::quiet_NaN());
+	for(const auto& ins : prog.Code())
+		if(ins.op == Opcode::load)
+			slots.push_back(ins.operand);
+	sort(slots.begin(), slots.end());
+	slots.erase(unique(slots.begin(), slots.end()), slots.end());
+
+	const auto s = generate_scalar(prog, sign_index);
+	const bool avx = __builtin_cpu_supports("avx");
+	vector<unsigned char> b;
+
+	if(avx)
+		b = generate_batch(prog, sign_index, nan_index);
+
+	const size_t size = s.size() + b.size();
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if(p == MAP_FAILED)
+		return;
+
+	const auto bytes = static_cast<unsigned char*>(p);
+
+	memcpy(bytes, s.data(), s.size());
+	if(!b.empty())
+		memcpy(bytes + s.size(), b.data(), b.size());
+	if(mprotect(p, size, PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(p, size);
+		return;
+	}
+	region = p;
+	region_size = size;
+	scalar = reinterpret_cast<scalar_fn>(bytes);
+	if(!b.empty())
+		batch = reinterpret_cast<batch_fn>(bytes + s.size());
+#else
+	static_cast<void>(prog);
+#endif
+}
+
+JitProgram::~JitProgram()
+{
+#if CXX_JIT
+	if(region)
+		munmap(region, region_size);
+#endif
+}
+
+double
+JitProgram::Evaluate(const Environment& env) const
+{
+	assert(Compiled());
+
+	small_vector<double, 16> temps(temp_count);
+	double result;
+
+	if(scalar(env.Values(), constants.data(), temps.data(), &result) != 0)
+		throw runtime_error("divide by zero");
+	return result;
+}
+
+size_t
+JitProgram::EvaluateBatch(
+	const ColumnBindings& cols, double* out, unsigned char* errors) const
+{
+	assert(HasBatch());
+
+	const Environment& env = cols.GetEnvironment();
+	const size_t rows = cols.Rows();
+	const size_t nslots = slots.empty() ? 0 : slots.back() + 1;
+	vector<const double*> inputs(nslots);
+	// unbound slots read a block filled with their value; bound slots are
+	// copied here only for a partial last block
+	vector<double> blocks(slots.size() * jit_block_rows);
+	vector<double> temps(temp_count * 4);
+	vector<double> result(jit_block_rows);
+	unsigned char masks[jit_block_rows / 4];
+	size_t error_count = 0;
+
+	for(size_t i = 0; i != slots.size(); ++i)
+		if(!cols.Column(slots[i]))
+		{
+			fill_n(&blocks[i * jit_block_rows], jit_block_rows,
+				env.Value(slots[i]));
+			inputs[slots[i]] = &blocks[i * jit_block_rows];
+		}
+	for(size_t base = 0; base < rows; base += jit_block_rows)
+	{
+		const size_t n = min(jit_block_rows, rows - base);
+		const size_t padded = (n + 3) & ~size_t(3);
+		const bool partial = padded != n;
+
+		for(size_t i = 0; i != slots.size(); ++i)
+			if(const double* col = cols.Column(slots[i]))
+			{
+				if(partial)
+				{
+					double* block = &blocks[i * jit_block_rows];
+
+					copy_n(col + base, n, block);
+					fill(block + n, block + padded, 1.0);
+					inputs[slots[i]] = block;
+				}
+				else
+					inputs[slots[i]] = col + base;
+			}
+		memset(masks, 0, padded / 4);
+		batch(inputs.data(), constants.data(), temps.data(),
+			partial ? result.data() : out + base, masks, padded * 8);
+		if(partial)
+			copy_n(result.data(), n, out + base);
+		for(size_t i = 0; i != n; ++i)
+		{
+			errors[base + i] = (masks[i / 4] >> (i % 4)) & 1
+				? row_divide_by_zero
+				: row_ok;
+			error_count += errors[base + i] != row_ok;
+		}
+	}
+	return error_count;
+}
+
+
+TieredProgram::TieredProgram(Program p, size_t hot_threshold)
+	: prog(std::move(p)), threshold(hot_threshold)
+{}
+
+void
+TieredProgram::count(size_t n)
+{
+	hits += n;
+	if(!tried && hits >= threshold)
+	{
+		tried = true;
+
+		auto j = make_unique<JitProgram>(prog);
+
+		if(j->Compiled())
+			jit = std::move(j);
+	}
+}
+
+double
+TieredProgram::Evaluate(const Environment& env)
+{
+	if(!jit)
+		count(1);
+	return jit ? jit->Evaluate(env) : prog.Evaluate(env);
+}
+
+size_t
+TieredProgram::EvaluateBatch(
+	const ColumnBindings& cols, double* out, unsigned char* errors)
+{
+	if(!jit)
+		count(cols.Rows());
+	return jit && jit->HasBatch() ? jit->EvaluateBatch(cols, out, errors)
+								  : cxx::EvaluateBatch(prog, cols, out, errors);
+}
+
+}
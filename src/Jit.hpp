@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Batch.hpp"
+
+namespace cxx
+{
+
+/*!
+\brief 编译为 x86-64 机器码的公式
+\note 标量代码使用 SSE2 ，批量代码使用 AVX 每次计算 4 行。
+	求值栈分配在 xmm/ymm 寄存器中，临时变量在内存中。
+\note 含取模（fmod 没有对应的指令）或栈深度超过寄存器数的程序不能编译，
+	此时 Compiled() 为 false ；不支持的平台或 CPU 上同样如此。
+\note 机器码在只读可执行的 mmap 区域中，可以被多个线程同时执行。
+*/
+class JitProgram
+{
+private:
+	using scalar_fn = int (*)(const double* vars, const double* consts,
+		double* temps, double* result);
+	using batch_fn = void (*)(const double* const* inputs,
+		const double* consts, double* temps, double* out,
+		unsigned char* masks, size_t bytes);
+
+	void* region = {};
+	size_t region_size = 0;
+	scalar_fn scalar = {};
+	batch_fn batch = {};
+	size_t temp_count = 0;
+	//! \brief 程序的常量，之后是符号位掩码和 NaN
+	vector<double> constants;
+	//! \brief 程序读取的槽
+	vector<uint32_t> slots;
+
+public:
+	explicit JitProgram(const Program& prog);
+	JitProgram(const JitProgram&) = delete;
+	~JitProgram();
+
+	JitProgram&
+	operator=(const JitProgram&)
+		= delete;
+
+	bool
+	Compiled() const noexcept
+	{
+		return scalar != nullptr;
+	}
+	bool
+	HasBatch() const noexcept
+	{
+		return batch != nullptr;
+	}
+
+	//! \pre Compiled()
+	double
+	Evaluate(const Environment& env) const;
+	/*!
+	\pre HasBatch()
+	\return 出错的行数
+	\note 结果和错误标记与 cxx::EvaluateBatch 相同。
+	*/
+	size_t
+	EvaluateBatch(const ColumnBindings& cols, double* out,
+		unsigned char* errors) const;
+};
+
+/*!
+\brief 按热度分层执行的公式
+\note 先由解释器执行，求值的行数达到阈值后尝试编译为机器码，
+	不能编译时继续使用解释器。
+\note 不是线程安全的。
+*/
+class TieredProgram
+{
+private:
+	Program prog;
+	size_t threshold;
+	size_t hits = 0;
+	bool tried = false;
+	unique_ptr<JitProgram> jit;
+
+public:
+	explicit TieredProgram(Program p, size_t hot_threshold = 1000);
+
+	const Program&
+	GetProgram() const noexcept
+	{
+		return prog;
+	}
+	bool
+	IsNative() const noexcept
+	{
+		return jit != nullptr;
+	}
+
+	double
+	Evaluate(const Environment& env);
+	size_t
+	EvaluateBatch(
+		const ColumnBindings& cols, double* out, unsigned char* errors);
+
+private:
+	void
+	count(size_t n);
+};
+
+}
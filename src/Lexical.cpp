@@ -1,35 +1,199 @@
-#include "Lexical.hpp"
+#include "Program.hpp"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#if !defined(_WIN32)
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
 
 namespace cxx
 {
 
-// The constructor just sets full to indicate that the buffer is empty:
-Token_stream::Token_stream() : full(false), buffer(0)
+#if !defined(_WIN32)
+mapped_file::mapped_file(const string& path)
+{
+	const int fd = ::open(path.c_str(), O_RDONLY);
+
+	if(fd < 0)
+		throw runtime_error(format("mapped_file: cannot open '{}'.", path));
+
+	struct stat st;
+
+	if(::fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		throw runtime_error(format("mapped_file: cannot stat '{}'.", path));
+	}
+	size = size_t(st.st_size);
+	if(size != 0)
+	{
+		void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		::close(fd);
+		if(p == MAP_FAILED)
+			throw runtime_error(format("mapped_file: cannot map '{}'.", path));
+		::madvise(p, size, MADV_SEQUENTIAL);
+		data = static_cast<const char*>(p);
+	}
+	else
+		::close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+	if(size != 0 && fallback.empty())
+		::munmap(const_cast<char*>(data), size);
+}
+#else
+mapped_file::mapped_file(const string& path)
+{
+	ifstream is(path, ios::binary);
+
+	if(!is)
+		throw runtime_error(format("mapped_file: cannot open '{}'.", path));
+
+	ostringstream oss;
+
+	oss << is.rdbuf();
+	fallback = oss.str();
+	data = fallback.data();
+	size = fallback.size();
+}
+
+mapped_file::~mapped_file() = default;
+#endif
+
+
+Token_stream::Token_stream() : Token_stream(cin, 0)
 {}
 
-// The putback() member function puts its argument back into the Token_stream's buffer:
+Token_stream::Token_stream(string_view src) noexcept
+	: pos(src.data()), last(src.data() + src.size())
+{}
+
+Token_stream::Token_stream(istream& is, size_t chunk_size)
+	: in(&is), chunk(chunk_size)
+{}
+
+Token
+Token_stream::get()
+{
+	if(count != 0)
+	{ // do we already have a Token ready?
+		const Token t = ring[head];
+
+		head = (head + 1) % lookahead;
+		--count;
+		return t;
+	}
+	return lex();
+}
+
+const Token&
+Token_stream::peek(size_t k)
+{
+	assert(k < lookahead);
+	for(; count <= k; ++count)
+		ring[(head + count) % lookahead] = lex();
+	return ring[(head + k) % lookahead];
+}
+
+// The putback() member function puts its argument back in front of the lookahead ring:
 void
 Token_stream::putback(Token t)
 {
-	if(full)
+	if(count == lookahead)
 		throw runtime_error("token_stream::putback() into a full buffer");
-	buffer = t; // copy t to buffer
-	full = true; // buffer is now full
+	head = (head + lookahead - 1) % lookahead;
+	ring[head] = t;
+	++count;
 }
 
+bool
+Token_stream::refill()
+{
+	if(!in)
+		return false;
 
-Token
-Token_stream::get()
+	// identifiers waiting in the ring still refer to the window, so the
+	// kept part starts at the oldest of them
+	const char* base = pos;
+
+	for(size_t i = 0; i != count; ++i)
+	{
+		const auto& name = ring[(head + i) % lookahead].name;
+
+		if(!name.empty() && name.data() < base)
+			base = name.data();
+	}
+
+	size_t offsets[lookahead];
+
+	for(size_t i = 0; i != count; ++i)
+		offsets[i] = size_t(ring[(head + i) % lookahead].name.data() - base);
+
+	const size_t keep = size_t(last - base);
+	const size_t unread = size_t(last - pos);
+	bool more;
+
+	if(keep != 0)
+		memmove(&storage[0], base, keep);
+	storage.resize(keep);
+	if(chunk == 0)
+	{
+		string line;
+
+		more = bool(getline(*in, line));
+		if(more)
+		{
+			storage += line;
+			storage += '\n';
+		}
+	}
+	else
+	{
+		storage.resize(keep + chunk);
+		in->read(&storage[keep], streamsize(chunk));
+		storage.resize(keep + size_t(in->gcount()));
+		more = storage.size() != keep;
+	}
+
+	const char* data = storage.data();
+
+	for(size_t i = 0; i != count; ++i)
+	{
+		auto& name = ring[(head + i) % lookahead].name;
+
+		if(!name.empty())
+			name = string_view(data + offsets[i], name.size());
+	}
+	pos = data + keep - unread;
+	last = data + storage.size();
+	return more;
+}
+
+bool
+Token_stream::skip_space()
 {
-	if(full)
-	{ // do we already have a Token ready?
-		// remove token from buffer
-		full = false;
-		return buffer;
+	while(true)
+	{
+		while(pos != last && isspace(static_cast<unsigned char>(*pos)))
+			++pos;
+		if(pos != last || !refill())
+			return pos != last;
 	}
+}
 
-	char ch;
-	cin >> ch;
+Token
+Token_stream::lex()
+{
+	if(!skip_space())
+		return Token{exit}; // end of input ends the session
+
+	const char ch = *pos;
 
 	switch(ch)
 	{
@@ -42,6 +206,7 @@ Token_stream::get()
 	case '/':
 	case '%':
 	case '=':
+		++pos;
 		return Token{ch}; // let each character represent itself
 	case '.':
 	case '0':
@@ -54,20 +219,48 @@ Token_stream::get()
 	case '7':
 	case '8':
 	case '9': {
-		cin.putback(ch); // put digit back into the input stream
+		// make sure the whole literal is in the window before parsing it
+		size_t n = 0;
+		while(true)
+		{
+			for(; pos + n != last; ++n)
+			{
+				const char c = pos[n];
+
+				if(!(isdigit(static_cast<unsigned char>(c)) || c == '.'
+					   || c == 'e' || c == 'E'
+					   || ((c == '+' || c == '-') && n != 0
+						   && (pos[n - 1] == 'e' || pos[n - 1] == 'E'))))
+					break;
+			}
+			if(pos + n != last || !refill())
+				break;
+		}
+
 		double val;
-		cin >> val; // read a floating-point number
+		const auto r = from_chars(pos, pos + n, val);
+
+		if(r.ec != errc())
+			throw runtime_error("token_stream::get: Bad number");
+		pos = r.ptr;
 		return Token{number, val};
 	}
 	default: // deal with Keyword and Variable
-		if(isalpha(ch))
+		if(isalpha(static_cast<unsigned char>(ch)))
 		{
-			string s;
-			s += ch;
-			while(cin.get(ch) && (isalpha(ch) || isdigit(ch)))
-				s += ch;
-			cin.putback(ch);
+			size_t n = 1;
+			while(true)
+			{
+				while(pos + n != last
+					&& isalnum(static_cast<unsigned char>(pos[n])))
+					++n;
+				if(pos + n != last || !refill())
+					break;
+			}
+
+			const string_view s(pos, n);
 
+			pos += n;
 			if(s == define_key)
 				return Token{definition};
 			if(s == assign_key)
@@ -77,6 +270,7 @@ Token_stream::get()
 
 			return Token{variable, s};
 		}
+		++pos;
 		throw runtime_error("token_stream::get: Bad token");
 	}
 }
@@ -84,26 +278,111 @@ Token_stream::get()
 void
 Token_stream::ignore(char c)
 { // c represents the kind of Token
-	// first look in buffer:
-	if(full && c == buffer.kind)
-	{
-		full = false;
-		return;
-	}
-	full = false;
+	// first look in the lookahead ring:
+	while(count != 0)
+		if(get().kind == c)
+			return;
 	// now search input:
-	char ch = 0;
-	while(cin >> ch)
-		if(ch == c)
+	do
+	{
+		if(pos != last)
+			if(const auto p = static_cast<const char*>(
+				   memchr(pos, c, size_t(last - pos))))
+			{
+				pos = p + 1;
+				return;
+			}
+		pos = last;
+	} while(refill());
+}
+
+Token_buffer::Token_buffer(string_view src)
+	: tokens(arena), names(arena), ids(0, {}, {}, arena), slots(arena)
+{
+	Token_stream ts(src);
+
+	// a rough estimate to avoid most regrowth in the arena
+	tokens.reserve(src.size() / 4 + 1);
+	do
+	{
+		Token t = ts.get();
+
+		if(t.kind == variable)
+		{
+			const auto i(ids.find(t.name));
+
+			if(i != ids.end())
+			{
+				t.id = i->second;
+				t.name = names[t.id];
+			}
+			else
+			{
+				const auto p(
+					static_cast<char*>(arena.allocate(t.name.size(), 1)));
+
+				memcpy(p, t.name.data(), t.name.size());
+				t.name = string_view(p, t.name.size());
+				t.id = uint32_t(names.size());
+				names.push_back(t.name);
+				ids.try_emplace(t.name, t.id);
+			}
+		}
+		tokens.push_back(t);
+	} while(tokens.back().kind != exit);
+}
+
+void
+Token_buffer::Resolve(const Environment& env)
+{
+	slots.clear();
+	for(const auto n : names)
+		slots.push_back(env.FindSlot(n));
+	resolved = env.BindingsId();
+}
+
+size_t
+Token_buffer::ResolvedSlot(uint32_t id, const Environment& env) const noexcept
+{
+	return id < slots.size() && env.SharesBindings(resolved)
+		? slots[id]
+		: Environment::no_slot;
+}
+
+void
+Token_buffer::ignore(char c) noexcept
+{
+	while(tokens[next].kind != exit)
+		if(tokens[next++].kind == c)
 			return;
 }
 
+Environment::Environment(Recompute r) : data(make_shared<Bindings>())
+{
+	data->recompute = r;
+}
+
+void
+Environment::SetRecompute(Recompute r)
+{
+	if(r != data->recompute)
+	{
+		if(data->stale_count != 0)
+			Refresh();
+		modify().recompute = r;
+	}
+}
+
 double
-Environment::Lookup(string_view id) const
+Environment::Lookup(string_view id)
 {
-	if(IsDefined(id))
-		return bindings.at({id.data(), id.size()});
+	const auto i(data->slots.find(id));
 
+	if(i != data->slots.end())
+	{
+		Refresh(i->second);
+		return data->values[i->second];
+	}
 	throw runtime_error(
 		format("Environment::Lookup: Unknown identifier: '{}'.", id));
 }
@@ -111,30 +390,207 @@ Environment::Lookup(string_view id) const
 void
 Environment::SetValue(string_view id, double val)
 {
-	if(IsDefined(id))
+	const auto i(data->slots.find(id));
+
+	if(i != data->slots.end())
 	{
-		bindings[{id.data(), id.size()}] = val;
+		if(IsConstant(i->second))
+			throw runtime_error(format(
+				"Environment::SetValue: Cannot assign constant: '{}'.", id));
+		SetValue(i->second, val);
 		return;
 	}
 	throw runtime_error(
 		format("Environment::SetValue: Unknown identifier: '{}'.", id));
 }
 
+void
+Environment::SetValue(size_t slot, double val)
+{
+	auto& b = modify();
+
+	b.values[slot] = val;
+	if(b.formulas[slot].prog)
+	{ // the slot becomes a plain variable
+		for(const auto in : b.formulas[slot].inputs)
+		{
+			auto& d = b.dependents[in];
+
+			d.erase(find(d.begin(), d.end(), slot));
+		}
+		b.formulas[slot] = {};
+		if(b.stale[slot])
+		{
+			b.stale[slot] = 0;
+			--b.stale_count;
+		}
+	}
+	if(!b.dependents[slot].empty())
+	{
+		vector<uint32_t> marked;
+
+		invalidate(slot, marked);
+		if(b.recompute == Recompute::eager)
+			reevaluate(marked);
+	}
+}
+
 bool
 Environment::IsDefined(string_view id) const
 {
-	return bindings.find({id.data(), id.size()}) != bindings.end();
+	return data->slots.contains(id);
 }
 
 void
 Environment::Define(string_view id, double val)
 {
-	if(IsDefined(id))
+	define(id, val, false);
+}
+
+void
+Environment::DefineConstant(string_view id, double val)
+{
+	define(id, val, true);
+}
+
+void
+Environment::DefineFormula(
+	string_view id, shared_ptr<const Program> prog, double val)
+{
+	assert(prog);
+
+	vector<uint32_t> inputs;
+
+	for(const auto& ins : prog->Code())
+		if(ins.op == Opcode::load)
+			inputs.push_back(ins.operand);
+	sort(inputs.begin(), inputs.end());
+	inputs.erase(unique(inputs.begin(), inputs.end()), inputs.end());
+	define(id, val, false);
+
+	auto& b = modify();
+	const auto slot = uint32_t(b.values.size() - 1);
+
+	for(const auto in : inputs)
+		b.dependents[in].push_back(slot);
+	b.formulas[slot] = Formula{std::move(prog), std::move(inputs)};
+}
+
+void
+Environment::define(string_view id, double val, bool constant)
+{
+	auto& b = modify();
+
+	if(!b.slots.try_emplace(id, b.values.size()).second)
 		throw runtime_error(
 			format("Environment::Define: Duplicate identifier: '{}'.", id));
+	b.values.push_back(val);
+	b.constants.push_back(constant);
+	b.formulas.emplace_back();
+	b.dependents.emplace_back();
+	b.stale.push_back(0);
+}
+
+void
+Environment::Refresh()
+{
+	if(data->stale_count == 0)
+		return;
+
+	vector<uint32_t> slots;
+
+	for(size_t i = 0; i != data->stale.size(); ++i)
+		if(data->stale[i])
+			slots.push_back(uint32_t(i));
+	reevaluate(slots);
+}
+
+void
+Environment::invalidate(size_t slot, vector<uint32_t>& marked)
+{
+	auto& b = *data;
+	vector<uint32_t> pending(b.dependents[slot]);
+
+	// a stale formula's dependents are already stale, so stop there
+	while(!pending.empty())
+	{
+		const auto s = pending.back();
+
+		pending.pop_back();
+		if(!b.stale[s])
+		{
+			b.stale[s] = 1;
+			++b.stale_count;
+			marked.push_back(s);
+			pending.insert(
+				pending.end(), b.dependents[s].begin(), b.dependents[s].end());
+		}
+	}
+}
+
+void
+Environment::reevaluate(vector<uint32_t>& slots)
+{
+	// formulas only read earlier slots, so slot order is topological; an
+	// exception leaves the failing formula and the ones after it stale
+	sort(slots.begin(), slots.end());
+
+	auto& b = modify();
 
-	bindings.insert({{id.data(), id.size()}, val});
+	for(const auto s : slots)
+		if(b.stale[s])
+		{
+			b.values[s] = b.formulas[s].prog->Evaluate(*this);
+			b.stale[s] = 0;
+			--b.stale_count;
+		}
 }
 
+void
+Environment::refresh(size_t slot)
+{
+	auto& b = modify();
+	vector<uint32_t> slots{uint32_t(slot)}, pending{uint32_t(slot)};
+
+	// collect the stale formulas this one reads directly or indirectly,
+	// using 2 to mark the ones already collected
+	b.stale[slot] = 2;
+	while(!pending.empty())
+	{
+		const auto s = pending.back();
+
+		pending.pop_back();
+		for(const auto in : b.formulas[s].inputs)
+			if(b.stale[in] == 1)
+			{
+				b.stale[in] = 2;
+				slots.push_back(in);
+				pending.push_back(in);
+			}
+	}
+	for(const auto s : slots)
+		b.stale[s] = 1;
+	reevaluate(slots);
+}
 
-}
\ No newline at end of file
+size_t
+Environment::FindSlot(string_view id) const noexcept
+{
+	const auto i(data->slots.find(id));
+
+	return i != data->slots.end() ? i->second : no_slot;
+}
+
+size_t
+Environment::Slot(string_view id) const
+{
+	const auto i(data->slots.find(id));
+
+	if(i != data->slots.end())
+		return i->second;
+	throw runtime_error(
+		format("Environment::Slot: Unknown identifier: '{}'.", id));
+}
+
+
+}
@@ -0,0 +1,499 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+#include "cxx/allocator.hpp"
+#include "cxx/hash_map.hpp"
+#include "cxx/vector.hpp"
+
+using namespace std;
+using fmt::format;
+
+inline void
+keep_window_open()
+{
+	cin.clear();
+	cout << "Please enter a character to exit\n";
+
+	char ch;
+
+	cin >> ch;
+}
+
+inline void
+keep_window_open(string s)
+{
+	if(s.empty())
+		return;
+	cin.clear();
+	cin.ignore(120, '\n');
+	for(string ss; cin >> ss && ss != s;)
+		cout << "Please enter " << s << " to exit\n";
+}
+
+namespace cxx
+{
+
+constexpr char number = '8';
+constexpr char variable = 'a';
+constexpr char definition = 'L';
+constexpr char assignment = 'A';
+constexpr char print = ';';
+constexpr char exit = 'q';
+
+constexpr string_view define_key{"let"};
+constexpr string_view assign_key{"assign"};
+constexpr string_view exit_key{"exit"};
+
+//! \brief 没有驻留编号的标识符
+constexpr uint32_t no_identifier = uint32_t(-1);
+
+/*!
+\brief 记号
+\note name 引用 Token_stream 的缓冲区，只在下一次 Token_stream::get 之前有效。
+\note id 是标识符在 Token_buffer 中的驻留编号，其它来源的记号为 no_identifier 。
+*/
+struct Token
+{
+	char kind;
+	uint32_t id = no_identifier;
+	double value;
+	string_view name;
+
+	Token(char ch = 0) : kind(ch), value(0)
+	{}
+	Token(char ch, double val) : kind(ch), value(val)
+	{}
+	Token(char ch, string_view n, uint32_t i = no_identifier)
+		: kind(ch), id(i), value(0), name(n)
+	{}
+};
+
+/*!
+\brief 只读映射到内存的文件
+\note 不支持 mmap 的平台上读入整个文件。
+*/
+class mapped_file
+{
+private:
+	const char* data = {};
+	size_t size = 0;
+	string fallback;
+
+public:
+	explicit mapped_file(const string& path);
+	mapped_file(const mapped_file&) = delete;
+	~mapped_file();
+
+	mapped_file&
+	operator=(const mapped_file&)
+		= delete;
+
+	string_view
+	view() const noexcept
+	{
+		return {data, size};
+	}
+};
+
+/*!
+\brief 从字符缓冲区读取记号
+\note 记号直接从连续的字符窗口中切分，标识符是窗口的视图，
+	数值用 from_chars 解析。
+\note 以 string_view 构造时窗口即整个输入，输入需要在使用期间保持有效；
+	以 istream 构造时按块读入内部缓冲区，记号跨越块边界时保留未读部分
+	再读入下一块。
+\note 已读出但未取走的记号保存在容量为 lookahead 的环形缓冲区中，
+	其中标识符的视图在读入新块时仍然有效。
+\note 输入结束时返回 exit 记号。
+*/
+class Token_stream
+{
+public:
+	static constexpr size_t lookahead = 4;
+
+	//! \brief 逐行读取 cin ，适合交互使用
+	Token_stream();
+	explicit Token_stream(string_view src) noexcept;
+	/*!
+	\brief 从输入流按块读取
+	\param chunk_size 每次读取的字节数，为 0 时逐行读取
+	*/
+	explicit Token_stream(istream& is, size_t chunk_size = 1 << 16);
+
+	Token
+	get();
+	//! \brief 查看之后的第 k 个记号而不取走，要求 k < lookahead
+	const Token&
+	peek(size_t k = 0);
+	//! \brief 退回记号，已有 lookahead 个记号未取走时抛出异常
+	void
+	putback(Token t);
+	void
+	ignore(char c);
+
+private:
+	Token ring[lookahead];
+	size_t head = 0;
+	size_t count = 0;
+	const char* pos = {};
+	const char* last = {};
+	istream* in = {};
+	size_t chunk = 0;
+	string storage;
+
+	//! \brief 从字符窗口切分下一个记号
+	Token
+	lex();
+	//! \brief 跳过空白，输入结束时返回 false
+	bool
+	skip_space();
+	//! \brief 保留未读的字符并读入更多输入，没有更多输入时返回 false
+	bool
+	refill();
+};
+
+class Environment;
+
+/*!
+\brief 预先切分的记号序列
+\note 记号连续存放，取记号和向前查看都只是下标运算。
+\note 序列总是以 exit 记号结尾，读到末尾后重复返回 exit 。
+\note 记号、标识符和解析的槽号都从自己的 monotonic_arena 分配，
+	析构时一次释放。标识符被驻留：相同的名称只保存一份并有相同的 id ，
+	不引用原始输入。
+*/
+class Token_buffer
+{
+public:
+	using token_vector = vector<Token, arena_allocator<Token>>;
+
+private:
+	monotonic_arena arena;
+	token_vector tokens;
+	//! \brief 按 id 排列的标识符
+	vector<string_view, arena_allocator<string_view>> names;
+	hash_map<string_view, uint32_t, hash<string_view>, equal_to<>,
+		arena_allocator<pair<const string_view, uint32_t>>>
+		ids;
+	//! \brief 按 id 排列的槽号，未定义的为 Environment::no_slot
+	vector<size_t, arena_allocator<size_t>> slots;
+	//! \brief 解析槽号时的绑定
+	weak_ptr<const void> resolved;
+	size_t next = 0;
+
+public:
+	//! \brief 切分 src 中所有的记号直到 exit
+	explicit Token_buffer(string_view src);
+	Token_buffer(const Token_buffer&) = delete;
+
+	Token_buffer&
+	operator=(const Token_buffer&)
+		= delete;
+
+	Token
+	get() noexcept
+	{
+		const Token& t = tokens[next];
+
+		next += next + 1 < tokens.size();
+		return t;
+	}
+	const Token&
+	peek(size_t k = 0) const noexcept
+	{
+		return tokens[min(next + k, tokens.size() - 1)];
+	}
+	void
+	ignore(char c) noexcept;
+
+	const token_vector&
+	Tokens() const noexcept
+	{
+		return tokens;
+	}
+	size_t
+	Position() const noexcept
+	{
+		return next;
+	}
+	size_t
+	IdentifierCount() const noexcept
+	{
+		return names.size();
+	}
+	string_view
+	Identifier(uint32_t id) const noexcept
+	{
+		return names[id];
+	}
+
+	/*!
+	\brief 在 env 中预先查找所有标识符的槽号
+	\note 之后在和 env 共享绑定的 Environment 中编译时，
+		变量按 id 取槽号而不再按名称查找。
+	*/
+	void
+	Resolve(const Environment& env);
+	/*!
+	\brief 取 Resolve 得到的标识符的槽号
+	\return 槽号；未对 env 的绑定解析或标识符当时未定义时为 Environment::no_slot
+	*/
+	size_t
+	ResolvedSlot(uint32_t id, const Environment& env) const noexcept;
+};
+
+/*!
+\brief 记号区间上的游标
+\note 读到区间末尾后重复返回 exit 记号。不拥有记号，区间需要保持有效。
+*/
+class Token_cursor
+{
+private:
+	const Token* cur;
+	const Token* last;
+	Token end_token{exit};
+	const Token_buffer* buffer = {};
+
+public:
+	Token_cursor(const Token* first, const Token* l) noexcept
+		: cur(first), last(l)
+	{}
+	//! \brief Token_buffer 中 [first, l) 的记号，编译时使用其解析的槽号
+	Token_cursor(const Token_buffer& buf, size_t first, size_t l) noexcept
+		: cur(buf.Tokens().data() + first), last(buf.Tokens().data() + l),
+		  buffer(&buf)
+	{}
+
+	const Token_buffer*
+	Buffer() const noexcept
+	{
+		return buffer;
+	}
+
+	Token
+	get() noexcept
+	{
+		return cur != last ? *cur++ : end_token;
+	}
+	const Token&
+	peek(size_t k = 0) const noexcept
+	{
+		return size_t(last - cur) > k ? cur[k] : end_token;
+	}
+	void
+	ignore(char c) noexcept
+	{
+		while(cur != last)
+			if((cur++)->kind == c)
+				return;
+	}
+	bool
+	empty() const noexcept
+	{
+		return cur == last;
+	}
+};
+
+//! \brief 以 string_view 查找 string 键的透明散列
+struct string_hash
+{
+	using is_transparent = void;
+
+	size_t
+	operator()(string_view s) const noexcept
+	{
+		return hash<string_view>()(s);
+	}
+};
+
+class Program;
+
+/*!
+\brief 变量绑定
+\note 每个变量在定义时分配一个槽号，槽号在 Environment 的生存期内不变，
+	编译后的程序按槽号访问变量而不再查找名称。
+\note 写时复制：复制 Environment 只共享绑定，修改共享的绑定前才复制，
+	因此可以廉价地为每个线程或每条语句建立快照。修改会使之前
+	Values() 返回的指针失效。
+\note 变量可以是公式：保存编译后的程序和它读取的变量。修改一个变量时
+	只有直接或间接依赖它的公式过期，按 GetRecompute() 立即或在下次读取时
+	重算。公式只能引用先定义的变量，所以依赖图无环，槽号顺序即拓扑顺序。
+*/
+class Environment
+{
+public:
+	//! \brief let 定义的重算方式
+	enum class Recompute : unsigned char
+	{
+		//! \brief 只保存定义时的值，不建立公式
+		never,
+		//! \brief 修改输入时只标记依赖的公式，读取时才重算
+		lazy,
+		//! \brief 修改输入后按拓扑顺序立即重算依赖的公式
+		eager
+	};
+
+	explicit Environment(Recompute r = Recompute::never);
+
+	Recompute
+	GetRecompute() const noexcept
+	{
+		return data->recompute;
+	}
+	//! \note 从 lazy 改为其它方式时先重算所有过期的公式。
+	void
+	SetRecompute(Recompute r);
+
+	//! \note 变量是过期的公式时先重算。
+	double
+	Lookup(string_view id);
+	void
+	SetValue(string_view id, double val);
+	bool
+	IsDefined(string_view id) const;
+	void
+	Define(string_view id, double val);
+	//! \brief 定义不可赋值的常量，编译时直接代入其值
+	void
+	DefineConstant(string_view id, double val);
+	/*!
+	\brief 定义公式变量
+	\pre val 是 prog 在当前变量值下的值。
+	\note 赋值给公式变量时公式被删除，变量成为普通变量。
+	*/
+	void
+	DefineFormula(string_view id, shared_ptr<const Program> prog, double val);
+
+	static constexpr size_t no_slot = size_t(-1);
+
+	//! \brief 取变量的槽号，变量未定义时抛出异常
+	size_t
+	Slot(string_view id) const;
+	//! \brief 取变量的槽号，变量未定义时为 no_slot
+	size_t
+	FindSlot(string_view id) const noexcept;
+	size_t
+	SlotCount() const noexcept
+	{
+		return data->values.size();
+	}
+	//! \note 不重算过期的公式。
+	double
+	Value(size_t slot) const noexcept
+	{
+		return data->values[slot];
+	}
+	bool
+	IsConstant(size_t slot) const noexcept
+	{
+		return data->constants[slot] != 0;
+	}
+	bool
+	IsFormula(size_t slot) const noexcept
+	{
+		return bool(data->formulas[slot].prog);
+	}
+	bool
+	IsStale(size_t slot) const noexcept
+	{
+		return data->stale[slot] != 0;
+	}
+	//! \note 不检查常量。
+	void
+	SetValue(size_t slot, double val);
+	//! \brief 按槽号排列的所有变量的值
+	const double*
+	Values() const noexcept
+	{
+		return data->values.data();
+	}
+
+	/*!
+	\brief 判断是否使用 id 标识的绑定
+	\note 绑定只会追加变量，因此之后已有变量的槽号仍然相同。
+	*/
+	bool
+	SharesBindings(const weak_ptr<const void>& id) const noexcept
+	{
+		return !id.owner_before(data) && !data.owner_before(id);
+	}
+	weak_ptr<const void>
+	BindingsId() const noexcept
+	{
+		return data;
+	}
+
+	//! \brief 重算槽中过期的公式和它依赖的过期公式
+	void
+	Refresh(size_t slot)
+	{
+		if(data->stale[slot])
+			refresh(slot);
+	}
+	//! \brief 按拓扑顺序重算所有过期的公式
+	void
+	Refresh();
+
+private:
+	struct Formula
+	{
+		shared_ptr<const Program> prog;
+		//! \brief 公式读取的槽，无重复
+		vector<uint32_t> inputs;
+	};
+
+	struct Bindings
+	{
+		//! \note 每次访问只计算一次散列，查找不构造临时 string 。
+		hash_map<string, size_t, string_hash, equal_to<>> slots;
+		vector<double> values;
+		//! \brief 每个槽是否为常量
+		vector<unsigned char> constants;
+		//! \brief 每个槽的公式，普通变量的 prog 为空
+		vector<Formula> formulas;
+		//! \brief 每个槽被哪些公式直接读取
+		vector<vector<uint32_t>> dependents;
+		/*!
+		\brief 每个槽的公式是否过期
+		\note 过期的公式的所有依赖者也都过期。
+		*/
+		vector<unsigned char> stale;
+		size_t stale_count = 0;
+		Recompute recompute;
+	};
+
+	shared_ptr<Bindings> data;
+
+	void
+	define(string_view id, double val, bool constant);
+	//! \brief 取得可以修改的绑定，和其它快照共享时先复制
+	Bindings&
+	modify()
+	{
+		if(data.use_count() != 1)
+			data = make_shared<Bindings>(*data);
+		return *data;
+	}
+	//! \brief 把依赖槽的公式标记为过期，新过期的槽追加到 marked
+	void
+	invalidate(size_t slot, vector<uint32_t>& marked);
+	//! \brief 按槽号顺序重算 slots 中的公式
+	void
+	reevaluate(vector<uint32_t>& slots);
+	void
+	refresh(size_t slot);
+};
+
+}
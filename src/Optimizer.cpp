@@ -0,0 +1,370 @@
+#include "Program.hpp"
+#include <cstring>
+
+namespace cxx
+{
+
+namespace
+{
+
+// A node of the expression DAG. For load, a is the slot; for operators,
+// a and b are the operand nodes.
+struct Node
+{
+	Opcode op;
+	uint32_t a = 0;
+	uint32_t b = 0;
+	double value = 0;
+	// evaluating the node may hit a zero divisor
+	bool may_fail = false;
+};
+
+struct NodeKey
+{
+	Opcode op;
+	uint32_t a;
+	uint32_t b;
+	uint64_t bits;
+
+	friend bool
+	operator==(const NodeKey& x, const NodeKey& y) noexcept
+	{
+		return x.op == y.op && x.a == y.a && x.b == y.b && x.bits == y.bits;
+	}
+};
+
+struct NodeKeyHash
+{
+	size_t
+	operator()(const NodeKey& k) const noexcept
+	{
+		return size_t(k.bits ^ (uint64_t(k.a) << 32 | k.b) * 31
+			^ uint64_t(k.op) << 56);
+	}
+};
+
+bool
+is_commutative(Opcode op) noexcept
+{
+	return op == Opcode::add || op == Opcode::multiply;
+}
+
+// c and 1 / c are normal powers of two, so x / c == x * (1 / c) exactly
+bool
+has_exact_reciprocal(double c) noexcept
+{
+	int e;
+
+	return isnormal(c) && isnormal(1 / c) && fabs(frexp(c, &e)) == 0.5;
+}
+
+// Per-call scratch storage of Optimize; the nodes, the hash index and the
+// emitter's tables all come from one arena and are dropped together.
+template<typename _type>
+using scratch_vector = vector<_type, arena_allocator<_type>>;
+
+// Builds the DAG bottom-up. Every node is created through make(), which
+// returns the existing node for an identical operation on identical
+// operands, so common subexpressions are shared as they are built.
+class Dag
+{
+public:
+	scratch_vector<Node> nodes;
+
+private:
+	hash_map<NodeKey, uint32_t, NodeKeyHash, equal_to<NodeKey>,
+		arena_allocator<pair<const NodeKey, uint32_t>>>
+		index;
+
+public:
+	Dag(monotonic_arena& arena, size_t n)
+		: nodes(arena), index(n, {}, {}, arena)
+	{
+		nodes.reserve(n);
+	}
+
+	uint32_t
+	constant(double v)
+	{
+		Node n{Opcode::constant};
+
+		n.value = v;
+		return make(n);
+	}
+	uint32_t
+	load(uint32_t slot)
+	{
+		Node n{Opcode::load};
+
+		n.a = slot;
+		return make(n);
+	}
+	uint32_t
+	negate(uint32_t x)
+	{
+		const Node& n = nodes[x];
+
+		if(n.op == Opcode::constant)
+			return constant(-n.value);
+		if(n.op == Opcode::negate)
+			return n.a;
+		return make(Node{Opcode::negate, x});
+	}
+	uint32_t
+	binary(Opcode op, uint32_t x, uint32_t y)
+	{
+		double cx = 0, cy = 0;
+		bool kx = is_constant(x, cx), ky = is_constant(y, cy);
+
+		if(kx && ky)
+			switch(op)
+			{
+			case Opcode::add:
+				return constant(cx + cy);
+			case Opcode::subtract:
+				return constant(cx - cy);
+			case Opcode::multiply:
+				return constant(cx * cy);
+			case Opcode::divide:
+				if(cy != 0)
+					return constant(cx / cy);
+				break;
+			case Opcode::modulo:
+				if(cy != 0)
+					return constant(fmod(cx, cy));
+				break;
+			default:
+				break;
+			}
+		if(is_commutative(op) && kx && !ky)
+		{ // keep constants on the right
+			swap(x, y);
+			swap(cx, cy);
+			swap(kx, ky);
+		}
+		if(ky && !kx)
+			switch(op)
+			{
+			case Opcode::subtract:
+				if(cy == 0 && !signbit(cy)) // x - (+0) == x, also for x == -0
+					return x;
+				break;
+			case Opcode::multiply:
+				if(cy == 1)
+					return x;
+				if(cy == -1)
+					return negate(x);
+				if(cy == 2)
+					return binary(Opcode::add, x, x);
+				break;
+			case Opcode::divide:
+				if(cy == 1)
+					return x;
+				if(cy == -1)
+					return negate(x);
+				if(has_exact_reciprocal(cy))
+					return binary(Opcode::multiply, x, constant(1 / cy));
+				break;
+			default:
+				break;
+			}
+		// a + b and b + a share a node unless swapping them could change
+		// which zero divisor is reported first
+		if(is_commutative(op) && x > y
+			&& !(nodes[x].may_fail && nodes[y].may_fail))
+			swap(x, y);
+
+		Node n{op, x, y};
+
+		n.may_fail = nodes[x].may_fail || nodes[y].may_fail
+			|| ((op == Opcode::divide || op == Opcode::modulo)
+				&& !(ky && cy != 0));
+		return make(n);
+	}
+
+private:
+	bool
+	is_constant(uint32_t x, double& v) const noexcept
+	{
+		if(nodes[x].op == Opcode::constant)
+		{
+			v = nodes[x].value;
+			return true;
+		}
+		return false;
+	}
+	uint32_t
+	make(const Node& n)
+	{
+		NodeKey k{n.op, n.a, n.b, 0};
+
+		memcpy(&k.bits, &n.value, sizeof(double));
+
+		const auto r = index.try_emplace(k, uint32_t(nodes.size()));
+
+		if(r.second)
+		{
+			Node m = n;
+
+			if(n.op == Opcode::negate)
+				m.may_fail = nodes[n.a].may_fail;
+			nodes.push_back(m);
+		}
+		return r.first->second;
+	}
+};
+
+// Emits postfix code for the DAG in the original left-to-right order.
+// A non-trivial node used more than once is computed at its first use and
+// saved to a temporary; later uses reload it.
+class Emitter
+{
+private:
+	const scratch_vector<Node>& nodes;
+	scratch_vector<uint32_t> uses;
+	scratch_vector<uint32_t> temps;
+	scratch_vector<uint32_t> constant_index;
+	static constexpr uint32_t none = uint32_t(-1);
+
+public:
+	vector<Instruction> code;
+	vector<double> constants;
+	size_t depth = 0;
+	size_t max_depth = 0;
+	size_t temp_count = 0;
+
+	Emitter(monotonic_arena& arena, const scratch_vector<Node>& n,
+		uint32_t root)
+		: nodes(n), uses(n.size(), 0, arena), temps(n.size(), none, arena),
+		  constant_index(n.size(), none, arena)
+	{
+		count(root);
+		emit(root);
+	}
+
+private:
+	void
+	count(uint32_t x)
+	{
+		if(uses[x]++ != 0)
+			return;
+
+		const Node& n = nodes[x];
+
+		switch(n.op)
+		{
+		case Opcode::constant:
+		case Opcode::load:
+			break;
+		case Opcode::negate:
+			count(n.a);
+			break;
+		default:
+			count(n.a);
+			count(n.b);
+		}
+	}
+	void
+	push(Opcode op, size_t operand = 0)
+	{
+		code.push_back(Instruction{op, uint32_t(operand)});
+	}
+	void
+	emit(uint32_t x)
+	{
+		const Node& n = nodes[x];
+
+		if(temps[x] != none)
+		{
+			push(Opcode::reuse, temps[x]);
+			max_depth = max(max_depth, ++depth);
+			return;
+		}
+		switch(n.op)
+		{
+		case Opcode::constant:
+			if(constant_index[x] == none)
+			{
+				constant_index[x] = uint32_t(constants.size());
+				constants.push_back(n.value);
+			}
+			push(Opcode::constant, constant_index[x]);
+			max_depth = max(max_depth, ++depth);
+			return;
+		case Opcode::load:
+			push(Opcode::load, n.a);
+			max_depth = max(max_depth, ++depth);
+			return;
+		case Opcode::negate:
+			emit(n.a);
+			push(n.op);
+			break;
+		default:
+			emit(n.a);
+			emit(n.b);
+			push(n.op);
+			--depth;
+		}
+		if(uses[x] > 1)
+		{
+			temps[x] = uint32_t(temp_count++);
+			push(Opcode::store, temps[x]);
+		}
+	}
+};
+
+} // unnamed namespace;
+
+
+void
+Optimize(Program& prog)
+{
+	if(prog.code.empty())
+		return;
+
+	// typical statements fit in the buffer and never touch the heap
+	alignas(max_align_t) unsigned char buffer[4096];
+	monotonic_arena arena(buffer, sizeof(buffer));
+	Dag dag(arena, prog.code.size());
+	scratch_vector<uint32_t> stack(arena);
+	scratch_vector<uint32_t> temps(prog.temp_count, 0, arena);
+
+	stack.reserve(prog.stack_depth);
+
+	for(const auto& ins : prog.code)
+		switch(ins.op)
+		{
+		case Opcode::constant:
+			stack.push_back(dag.constant(prog.constants[ins.operand]));
+			break;
+		case Opcode::load:
+			stack.push_back(dag.load(ins.operand));
+			break;
+		case Opcode::negate:
+			stack.back() = dag.negate(stack.back());
+			break;
+		case Opcode::store:
+			temps[ins.operand] = stack.back();
+			break;
+		case Opcode::reuse:
+			stack.push_back(temps[ins.operand]);
+			break;
+		default:
+		{
+			const uint32_t y = stack.back();
+
+			stack.pop_back();
+			stack.back() = dag.binary(ins.op, stack.back(), y);
+		}
+		}
+	assert(stack.size() == 1);
+
+	Emitter out(arena, dag.nodes, stack.back());
+
+	prog.code = std::move(out.code);
+	prog.constants = std::move(out.constants);
+	prog.stack_depth = out.max_depth;
+	prog.temp_count = out.temp_count;
+}
+
+}
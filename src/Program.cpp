@@ -0,0 +1,326 @@
+#include "Program.hpp"
+
+namespace cxx
+{
+
+namespace
+{
+
+// the buffer whose resolved slots a token source can use, if any
+const Token_buffer*
+buffer_of(const Token_stream&) noexcept
+{
+	return nullptr;
+}
+const Token_buffer*
+buffer_of(const Token_buffer& ts) noexcept
+{
+	return &ts;
+}
+const Token_buffer*
+buffer_of(const Token_cursor& ts) noexcept
+{
+	return ts.Buffer();
+}
+
+} // unnamed namespace;
+
+// Compiler emits postfix code for the grammar that calculator.cpp used to
+// evaluate directly:
+//	Statement: Definition | Assignment | Expression
+//	Expression: Term | Expression '+' Term | Expression '-' Term
+//	Term: Primary | Term '*' Primary | Term '/' Primary | Term '%' Primary
+//	Primary: Number | Variable | '(' Expression ')' | '-' Primary | '+' Primary
+// Operators are recognized with peek() and consumed only when they match,
+// so the parser never has to put a token back.
+template<class _tTokens>
+class Compiler
+{
+private:
+	_tTokens& ts;
+	const Environment& env;
+	Program prog;
+	size_t depth = 0;
+
+public:
+	Compiler(_tTokens& s, const Environment& e) : ts(s), env(e)
+	{}
+
+	Program
+	statement()
+	{
+		switch(ts.peek().kind)
+		{
+		case definition:
+			ts.get();
+			prog.kind = Program::Kind::definition;
+			prog.name = string(
+				variable_name("name expected in definition").name);
+			break;
+		case assignment:
+		{
+			ts.get();
+			prog.kind = Program::Kind::assignment;
+
+			const Token t = variable_name("name expected in assignment");
+
+			prog.target = slot_of(t);
+			if(env.IsConstant(prog.target))
+				throw runtime_error(format(
+					"Environment::SetValue: Cannot assign constant: '{}'.",
+					t.name));
+			break;
+		}
+		}
+		expression();
+		Optimize(prog);
+		return std::move(prog);
+	}
+
+private:
+	Token
+	variable_name(const char* msg)
+	{
+		Token t = ts.get();
+		if(t.kind != variable)
+			throw runtime_error(msg);
+		return t;
+	}
+
+	// identifiers interned by a resolved Token_buffer skip the name lookup
+	size_t
+	slot_of(const Token& t) const
+	{
+		if(const Token_buffer* b = buffer_of(ts))
+		{
+			const size_t slot = b->ResolvedSlot(t.id, env);
+
+			if(slot != Environment::no_slot)
+				return slot;
+		}
+		return env.Slot(t.name);
+	}
+
+	void
+	emit(Opcode op, size_t operand = 0)
+	{
+		prog.code.push_back(Instruction{op, uint32_t(operand)});
+		switch(op)
+		{
+		case Opcode::constant:
+		case Opcode::load:
+		case Opcode::reuse:
+			if(++depth > prog.stack_depth)
+				prog.stack_depth = depth;
+			break;
+		case Opcode::negate:
+		case Opcode::store:
+			break;
+		default:
+			--depth;
+		}
+	}
+
+	// deal with numbers, parentheses, and variables
+	void
+	primary()
+	{
+		Token t = ts.get();
+		switch(t.kind)
+		{
+		case '(': // handle '(' expression ')'
+			expression();
+			if(ts.get().kind != ')')
+				throw runtime_error("')' expected");
+			return;
+		case number:
+			emit(Opcode::constant, prog.constants.size());
+			prog.constants.push_back(t.value);
+			return;
+		case '-':
+			primary();
+			emit(Opcode::negate);
+			return;
+		case '+':
+			primary();
+			return;
+		case variable:
+		{
+			const size_t slot = slot_of(t);
+
+			if(env.IsConstant(slot))
+			{
+				emit(Opcode::constant, prog.constants.size());
+				prog.constants.push_back(env.Value(slot));
+			}
+			else
+				emit(Opcode::load, slot);
+			return;
+		}
+		default:
+			throw runtime_error("primary expected");
+		}
+	}
+
+	// deal with *, /, and %
+	void
+	term()
+	{
+		primary();
+		while(true)
+		{
+			Opcode op;
+
+			switch(ts.peek().kind)
+			{
+			case '*':
+				op = Opcode::multiply;
+				break;
+			case '/':
+				op = Opcode::divide;
+				break;
+			case '%':
+				op = Opcode::modulo;
+				break;
+			default:
+				return;
+			}
+			ts.get();
+			primary();
+			emit(op);
+		}
+	}
+
+	// deal with + and -
+	void
+	expression()
+	{
+		term();
+		while(true)
+		{
+			Opcode op;
+
+			switch(ts.peek().kind)
+			{
+			case '+':
+				op = Opcode::add;
+				break;
+			case '-':
+				op = Opcode::subtract;
+				break;
+			default:
+				return;
+			}
+			ts.get();
+			term();
+			emit(op);
+		}
+	}
+};
+
+
+double
+Program::Evaluate(const Environment& env) const
+{
+	small_vector<double, 32> stack(stack_depth + temp_count);
+	double* sp = stack.data();
+	double* const temps = sp + stack_depth;
+	const double* vars = env.Values();
+
+	for(const auto& ins : code)
+		switch(ins.op)
+		{
+		case Opcode::constant:
+			*sp++ = constants[ins.operand];
+			break;
+		case Opcode::load:
+			*sp++ = vars[ins.operand];
+			break;
+		case Opcode::negate:
+			sp[-1] = -sp[-1];
+			break;
+		case Opcode::add:
+			--sp;
+			sp[-1] += *sp;
+			break;
+		case Opcode::subtract:
+			--sp;
+			sp[-1] -= *sp;
+			break;
+		case Opcode::multiply:
+			--sp;
+			sp[-1] *= *sp;
+			break;
+		case Opcode::divide:
+			--sp;
+			if(*sp == 0)
+				throw runtime_error("divide by zero");
+			sp[-1] /= *sp;
+			break;
+		case Opcode::modulo:
+			--sp;
+			if(*sp == 0)
+				throw runtime_error("%: divide by zero");
+			sp[-1] = fmod(sp[-1], *sp);
+			break;
+		case Opcode::store:
+			temps[ins.operand] = sp[-1];
+			break;
+		case Opcode::reuse:
+			*sp++ = temps[ins.operand];
+			break;
+		}
+	return stack[0];
+}
+
+double
+Program::Run(Environment& env) const
+{
+	bool reads_variables = false;
+
+	for(const auto& ins : code)
+		if(ins.op == Opcode::load)
+		{
+			env.Refresh(ins.operand);
+			reads_variables = true;
+		}
+
+	const double d = Evaluate(env);
+
+	switch(kind)
+	{
+	case Kind::definition:
+		if(reads_variables
+			&& env.GetRecompute() != Environment::Recompute::never)
+			env.DefineFormula(name, make_shared<const Program>(*this), d);
+		else
+			env.Define(name, d);
+		break;
+	case Kind::assignment:
+		env.SetValue(target, d);
+		break;
+	case Kind::expression:
+		break;
+	}
+	return d;
+}
+
+Program
+Compile(Token_stream& ts, const Environment& env)
+{
+	return Compiler<Token_stream>(ts, env).statement();
+}
+
+Program
+Compile(Token_buffer& ts, const Environment& env)
+{
+	return Compiler<Token_buffer>(ts, env).statement();
+}
+
+Program
+Compile(Token_cursor& ts, const Environment& env)
+{
+	return Compiler<Token_cursor>(ts, env).statement();
+}
+
+}
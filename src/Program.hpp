@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include "Lexical.hpp"
+
+namespace cxx
+{
+
+enum class Opcode : unsigned char
+{
+	constant, // 压入常量表中的第 operand 个常量
+	load, // 压入第 operand 个槽中的变量
+	negate,
+	add,
+	subtract,
+	multiply,
+	divide,
+	modulo,
+	store, // 把栈顶复制到第 operand 个临时变量，不出栈
+	reuse // 压入第 operand 个临时变量
+};
+
+struct Instruction
+{
+	Opcode op;
+	uint32_t operand;
+};
+
+/*!
+\brief 编译后的语句
+\note 表达式编译为后缀形式的字节码，变量解析为 Environment 的槽号，
+	求值时在栈机上执行，不再访问 Token_stream 。
+\note 同一程序可以在同一 Environment 的不同变量值下多次求值。
+*/
+class Program
+{
+	template<class>
+	friend class Compiler;
+	friend void
+	Optimize(Program&);
+
+public:
+	enum class Kind : unsigned char
+	{
+		expression,
+		definition,
+		assignment
+	};
+
+private:
+	vector<Instruction> code;
+	vector<double> constants;
+	size_t stack_depth = 0;
+	//! \brief 公共子表达式使用的临时变量数
+	size_t temp_count = 0;
+	Kind kind = Kind::expression;
+	//! \brief 定义语句定义的变量名
+	string name;
+	//! \brief 赋值语句的目标槽号
+	size_t target = 0;
+
+public:
+	Kind
+	GetKind() const noexcept
+	{
+		return kind;
+	}
+	const vector<Instruction>&
+	Code() const noexcept
+	{
+		return code;
+	}
+	const vector<double>&
+	Constants() const noexcept
+	{
+		return constants;
+	}
+	//! \brief 求值需要的最大栈深度
+	size_t
+	StackDepth() const noexcept
+	{
+		return stack_depth;
+	}
+	size_t
+	TempCount() const noexcept
+	{
+		return temp_count;
+	}
+
+	//! \brief 只求表达式的值，不执行定义或赋值
+	double
+	Evaluate(const Environment& env) const;
+	/*!
+	\brief 求值并执行定义或赋值
+	\note 先重算读取的过期公式。 env 保存公式时，读取变量的定义保存为公式。
+	*/
+	double
+	Run(Environment& env) const;
+};
+
+/*!
+\brief 化简程序中的表达式
+\note 把字节码还原为表达式 DAG ，相同的子表达式合并为一个节点，
+	在合并时折叠常量并做代数化简，再重新生成字节码；
+	被多次使用的子表达式只计算一次，结果保存在临时变量中。
+\note 只做在 IEEE 754 下结果完全相同的变换，例如 x * 2 变为 x + x ，
+	x / c 只在 c 是 2 的幂时变为 x * (1 / c) 。
+\note 除数可能为零的除法和取模不会被折叠或删除，
+	除数为零时仍然按原来的顺序报告。
+*/
+void
+Optimize(Program& prog);
+
+/*!
+\brief 从 Token_stream 读取一条语句并编译
+\note 变量在编译时解析，未定义的变量在编译时报告；常量直接代入其值。
+\note 编译结果经过 Optimize 化简。
+*/
+Program
+Compile(Token_stream& ts, const Environment& env);
+Program
+Compile(Token_buffer& ts, const Environment& env);
+Program
+Compile(Token_cursor& ts, const Environment& env);
+
+}
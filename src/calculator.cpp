@@ -1,4 +1,4 @@
-#include "Lexical.hpp"
+#include "Driver.hpp"
 
 using cxx::Token;
 using cxx::Token_stream;
@@ -6,21 +6,6 @@ using cxx::Environment;
 
 Environment env;
 
-double
-expression(Token_stream&);
-
-double
-primary(Token_stream&);
-
-double
-term(Token_stream&);
-
-double
-assignment(Token_stream&);
-
-double
-definition(Token_stream&);
-
 double
 statement(Token_stream&);
 
@@ -30,140 +15,11 @@ calculate(Token_stream&);
 void
 clean_up_mess(Token_stream&);
 
-// deal with numbers, parentheses, and variables
-double
-primary(Token_stream& ts)
-{
-	Token t = ts.get();
-	switch(t.kind)
-	{
-	case '(': // handle '(' expression ')'
-	{
-		double d = expression(ts);
-		t = ts.get();
-		if(t.kind != ')')
-			throw runtime_error("')' expected");
-		return d;
-	}
-	case cxx::number:
-		return t.value;
-	case '-':
-		return -primary(ts);
-	case '+':
-		return primary(ts);
-	case cxx::variable:
-		return env.Lookup(t.name);
-	default:
-		throw runtime_error("primary expected");
-	}
-}
-
-// deal with *, /, and %
-double
-term(Token_stream& ts)
-{
-	double left = primary(ts);
-	Token t = ts.get(); // get the next token from token stream
-
-	while(true)
-	{
-		switch(t.kind)
-		{
-		case '*':
-			left *= primary(ts);
-			t = ts.get();
-			break;
-		case '/': {
-			double d = primary(ts);
-			if(d == 0)
-				throw runtime_error("divide by zero");
-			left /= d;
-			t = ts.get();
-			break;
-		}
-		case '%': {
-			double d = primary(ts);
-			if(d == 0)
-				throw runtime_error("%: divide by zero");
-			left = fmod(left, d);
-			t = ts.get();
-			break;
-		}
-		default:
-			ts.putback(t); // put t back into the token stream
-			return left;
-		}
-	}
-}
-
-// deal with + and -
-double
-expression(Token_stream& ts)
-{
-	double left = term(ts); // read and evaluate a Term
-	Token t = ts.get(); // get the next token from token stream
-
-	while(true)
-	{
-		switch(t.kind)
-		{
-		case '+':
-			left += term(ts); // evaluate Term and add
-			t = ts.get();
-			break;
-		case '-':
-			left -= term(ts); // evaluate Term and subtract
-			t = ts.get();
-			break;
-		default:
-			ts.putback(t); // put t back into the token stream
-			return left; // finally: no more + or -: return the answer
-		}
-	}
-}
-
-// define a variable called "name” with the initial value "expression”
-double
-definition(Token_stream& ts)
-{
-	Token t = ts.get();
-	if(t.kind != cxx::variable)
-		throw runtime_error("name expected in definition");
-	string var_name = t.name;
-
-	double d = expression(ts);
-	env.Define(var_name, d);
-	return d;
-}
-
-double
-assignment(Token_stream& ts)
-{
-	Token t = ts.get();
-	if(t.kind != cxx::variable)
-		throw runtime_error("name expected in assignment");
-	string var_name = t.name;
-
-	double d = expression(ts);
-
-	env.SetValue(var_name, d);
-	return d;
-}
-
+// compile one statement and run it against the global environment
 double
 statement(Token_stream& ts)
 {
-	Token t = ts.get();
-	switch(t.kind)
-	{
-	case cxx::definition:
-		return definition(ts);
-	case cxx::assignment:
-		return assignment(ts);
-	default:
-		ts.putback(t);
-		return expression(ts);
-	}
+	return cxx::Compile(ts, env).Run(env);
 }
 
 void
@@ -201,15 +57,47 @@ calculate(Token_stream& ts) // expression evaluation loop
 }
 
 int
-main()
+main(int argc, char* argv[])
 try
 {
+	env.DefineConstant("pi", 3.1415926535);
+	env.DefineConstant("e", 2.7182818284);
+
+	if(argc > 1
+		&& (string_view(argv[1]) == "--lazy"
+			|| string_view(argv[1]) == "--eager"))
+	{ // keep let definitions as formulas that follow their inputs
+		env.SetRecompute(string_view(argv[1]) == "--lazy"
+				? Environment::Recompute::lazy
+				: Environment::Recompute::eager);
+		--argc;
+		++argv;
+	}
+	if(argc > 2 && string_view(argv[1]) == "--batch")
+	{ // run independent statements in parallel, print results in order
+		cxx::mapped_file script(argv[2]);
+		const unsigned threads = argc > 3 ? unsigned(stoul(argv[3])) : 0;
+
+		for(const auto& r : cxx::RunStatements(script.view(), env, threads))
+			if(r.error.empty())
+				cout << r.value << '\n';
+			else
+				cout << "error: " << r.error << '\n';
+		return 0;
+	}
+	if(argc > 1)
+	{ // run a script file
+		cxx::mapped_file script(argv[1]);
+		Token_stream ts(script.view());
+
+		calculate(ts);
+		return 0;
+	}
+
 	cout << "Welcome to our simple calculator.\n"
 		 << "Please enter expressions using floating-point numbers.\n";
 
 	Token_stream ts;
-	env.Define("pi", 3.1415926535);
-	env.Define("e", 2.7182818284);
 
 	calculate(ts);
 
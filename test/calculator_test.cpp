@@ -0,0 +1,254 @@
+#include "Jit.hpp"
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace
+{
+
+using std::cout;
+using std::endl;
+using std::exception;
+using std::string;
+
+//! \brief 失败的检查数，非零时 main 返回 1
+std::size_t failures = 0;
+
+void
+check(bool ok, const string& what)
+{
+	if(!ok && failures++ < 10)
+		cout << "FAILED: " << what << endl;
+}
+
+namespace jit_test
+{
+
+using cxx::ColumnBindings;
+using cxx::Environment;
+using cxx::JitProgram;
+using cxx::Program;
+using cxx::vector;
+
+std::mt19937 rng(11);
+
+// 变量 a 、 b 、 c 和常量 pi 、 e 以及包括 0 在内的字面量组成的随机公式，
+// 偶尔含有取模。
+string
+generate(int depth)
+{
+	static const char* const leaves[]{"a", "b", "c", "pi", "e", "0", "1", "2",
+		"-1", "0.5", "4", "3", "0.25"};
+	static const char* const ops[]{"+", "-", "*", "/", "%"};
+
+	if(depth == 0 || rng() % 4 == 0)
+		return leaves[rng() % 13];
+
+	const auto k = rng() % 7;
+
+	if(k == 5)
+		return "-" + generate(depth - 1);
+	if(k == 6)
+		return "(" + generate(depth - 1) + ")";
+	return "(" + generate(depth - 1) + ops[rng() % (rng() % 8 == 0 ? 5 : 4)]
+		+ generate(depth - 1) + ")";
+}
+
+// 变量的取值，包括 -0 和 NaN 除数
+const double values[]{0, 1, -1, 2, 0.5, -0.0, 3, 1e308, -4, 0.25,
+	std::numeric_limits<double>::quiet_NaN()};
+
+double
+random_value()
+{
+	return values[rng() % (sizeof(values) / sizeof(*values))];
+}
+
+// 按位比较，任意 NaN 视为相同
+bool
+same(double x, double y)
+{
+	return (x != x && y != y) || std::memcmp(&x, &y, sizeof(double)) == 0;
+}
+
+Program
+compile(const string& statement, const Environment& env)
+{
+	cxx::Token_buffer tb(statement + ";");
+
+	return cxx::Compile(tb, env);
+}
+
+// 求值并返回异常的消息，没有异常时消息为空
+template<class _tProgram>
+string
+evaluate(_tProgram& p, const Environment& env, double& value)
+{
+	try
+	{
+		value = p.Evaluate(env);
+	}
+	catch(exception& e)
+	{
+		return e.what();
+	}
+	return {};
+}
+
+// 除数为零时两者都应抛出相同的异常
+template<class _tProgram>
+bool
+same_result(const Program& p, _tProgram& q, const Environment& env)
+{
+	double v1 = 0, v2 = 0;
+	const auto e1 = evaluate(p, env, v1);
+	const auto e2 = evaluate(q, env, v2);
+
+	return e1 == e2 && (!e1.empty() || same(v1, v2));
+}
+
+// 比较解释器和机器码的单行求值
+void
+compare_scalar(const string& s, const Program& p, const JitProgram& j,
+	Environment& env)
+{
+	for(int r = 0; r != 20; ++r)
+	{
+		for(std::size_t slot = 0; slot != 3; ++slot)
+			env.SetValue(slot, random_value());
+
+		check(same_result(p, j, env), "scalar " + s);
+	}
+}
+
+// 比较批量求值的结果、错误标记和出错的行数
+void
+compare_batch(const string& s, const Program& p, const JitProgram& j,
+	const Environment& env, std::size_t rows)
+{
+	vector<double> a(rows), c(rows);
+
+	for(auto& x : a)
+		x = random_value();
+	for(auto& x : c)
+		x = random_value();
+
+	ColumnBindings cols(env, rows);
+
+	cols.Bind("a", a);
+	if(rng() % 2 != 0)
+		cols.Bind("c", c);
+
+	vector<double> o1(rows), o2(rows);
+	vector<unsigned char> r1(rows), r2(rows);
+	const auto n1 = cxx::EvaluateBatch(p, cols, o1.data(), r1.data());
+	const auto n2 = j.EvaluateBatch(cols, o2.data(), r2.data());
+	bool ok = n1 == n2;
+
+	for(std::size_t i = 0; i != rows; ++i)
+		ok = ok && r1[i] == r2[i] && (r1[i] != 0 || same(o1[i], o2[i]));
+	check(ok, "batch " + s + " rows " + std::to_string(rows));
+}
+
+void
+test()
+{
+	cout << "jit test:\n";
+
+	Environment env;
+
+	env.Define("a", 0);
+	env.Define("b", 0);
+	env.Define("c", 0);
+	env.DefineConstant("pi", 3.1415926535);
+	env.DefineConstant("e", 2.7182818284);
+
+	// 0 、 1 、 4 的倍数附近以及跨越 256 行的块边界
+	const std::size_t row_counts[]{0, 1, 3, 4, 5, 255, 256, 257, 517, 1024};
+	std::size_t compiled = 0, batches = 0;
+
+	for(int i = 0; i != 3000; ++i)
+	{
+		const string s = generate(7);
+		const Program p = compile(s, env);
+		const JitProgram j(p);
+
+		if(!j.Compiled())
+			continue;
+		++compiled;
+		compare_scalar(s, p, j, env);
+		if(j.HasBatch())
+		{
+			compare_batch(s, p, j, env, rng() % 700);
+			compare_batch(s, p, j, env, row_counts[i % 10]);
+			++batches;
+		}
+	}
+
+	// 公共子表达式保存在临时变量中
+	const string cses[]{"(a+b)*(a+b)/(a+b)", "(a/b+c)*(a/b+c)-a/b",
+		"-(a-c)/(b*(a-c))+(a-c)"};
+
+	for(const auto& s : cses)
+	{
+		const Program p = compile(s, env);
+		const JitProgram j(p);
+
+		check(p.TempCount() != 0, "temps " + s);
+		if(j.Compiled())
+		{
+			compare_scalar(s, p, j, env);
+			if(j.HasBatch())
+				for(const auto rows : row_counts)
+					compare_batch(s, p, j, env, rows);
+		}
+	}
+
+	// 取模和超过寄存器数的栈深度不能编译，分层执行时继续使用解释器
+	string deep("a");
+
+	for(int i = 0; i != 16; ++i)
+		deep = (i % 2 == 0 ? "b-(" : "c/(") + deep + ")";
+
+	const string fallbacks[]{"a%b", "(a+b)%(c-1)", deep};
+
+	for(const auto& s : fallbacks)
+	{
+		const Program p = compile(s, env);
+
+		check(!JitProgram(p).Compiled(), "fallback " + s);
+
+		cxx::TieredProgram tp(p, 4);
+
+		for(int r = 0; r != 8; ++r)
+		{
+			env.SetValue(std::size_t(0), double(r));
+			env.SetValue(std::size_t(1), 3.0);
+			env.SetValue(std::size_t(2), 7.0);
+			check(same_result(p, tp, env), "tiered " + s);
+		}
+		check(!tp.IsNative(), "tiered native " + s);
+	}
+	check(compile(deep, env).StackDepth() > 14, "depth " + deep);
+
+	cxx::TieredProgram tp(compile("a*b+c", env), 10);
+
+	for(int r = 0; r != 12; ++r)
+		tp.Evaluate(env);
+	cout << "compiled: " << (compiled != 0) << " batch: " << (batches != 0)
+		 << " native: " << tp.IsNative() << endl;
+}
+
+} // namespace jit_test
+
+} // unnamed namespace
+
+int
+main()
+{
+	jit_test::test();
+	cout << "failures: " << failures << endl;
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,455 @@
+#include "Chrono.hpp"
+#include "DateColumn.hpp"
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+using std::cout;
+using std::endl;
+using std::string;
+
+//! \brief 失败的检查数，非零时 main 返回 1
+std::size_t failures = 0;
+
+void
+check(bool ok, const string& what)
+{
+	if(!ok && failures++ < 10)
+		cout << "FAILED: " << what << endl;
+}
+
+string
+to_string(const cxx::Date& d)
+{
+	std::ostringstream os;
+
+	os << d;
+	return os.str();
+}
+
+namespace chrono_test
+{
+
+using cxx::Date;
+using cxx::Day;
+using cxx::Month;
+
+// 不使用 Chrono.hpp 的简单日历，逐日递增
+struct civil
+{
+	int y, m, d;
+	//! \brief 星期，星期日为 0
+	int wd;
+
+	static bool
+	leap(int y)
+	{
+		return y % 400 == 0 || (y % 4 == 0 && y % 100 != 0);
+	}
+	static int
+	length(int y, int m)
+	{
+		static const int lengths[]{31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30,
+			31};
+
+		return m == 2 && leap(y) ? 29 : lengths[m - 1];
+	}
+
+	void
+	next()
+	{
+		wd = (wd + 1) % 7;
+		if(++d > length(y, m))
+		{
+			d = 1;
+			if(++m > 12)
+			{
+				m = 1;
+				++y;
+			}
+		}
+	}
+	// 加上 n 个月，没有原来的日时使用再下个月的 1 日
+	civil
+	plus_months(int n) const
+	{
+		const int months = y * 12 + m - 1 + n;
+		const int ny = months >= 0 ? months / 12 : -((11 - months) / 12);
+		civil r{ny, months - ny * 12 + 1, d, 0};
+
+		if(d > length(r.y, r.m))
+			r = civil{r.y, r.m, 1, 0}.plus_months(1);
+		return r;
+	}
+};
+
+bool
+same(const Date& a, const civil& c)
+{
+	return a.year() == c.y && static_cast<int>(a.month()) == c.m
+		&& a.day() == c.d;
+}
+
+// 从 y-01-01 起逐日比较 n 天
+void
+walk(int y, int wd, int n)
+{
+	civil c{y, 1, 1, wd};
+	const Date first(y, Month::jan, 1);
+	int z = first.days();
+	Date prev = first;
+
+	for(int i = 0; i != n; ++i, ++z, c.next())
+	{
+		const Date a(z);
+		const string at = std::to_string(c.y) + '-' + std::to_string(c.m) + '-'
+			+ std::to_string(c.d);
+
+		check(same(a, c) && a.days() == z, "walk " + at);
+		check(a == Date(c.y, Month(c.m), c.d), "construct " + at);
+		check(static_cast<int>(cxx::day_of_week(a)) == c.wd, "weekday " + at);
+		check(i == 0 || (prev < a && a - prev == 1), "order " + at);
+		check(cxx::next_Sunday(a).days() == z + 7 - c.wd, "next_Sunday " + at);
+		check(cxx::next_weekday(a).days()
+				== z + (c.wd == 5 ? 3 : c.wd == 6 ? 2 : 1),
+			"next_weekday " + at);
+		for(const int n : {1, -1, 13, -25})
+		{
+			Date b = a;
+
+			b.add_month(n);
+			check(same(b, c.plus_months(n)), "add_month " + at);
+		}
+		prev = a;
+	}
+}
+
+void
+test()
+{
+	cout << "chrono test:\n";
+	// 1600-01-01 和 2000-01-01 都是星期六，覆盖 1700 、 1800 、 1900 和 2000 年
+	walk(1600, 6, 300000);
+	// 公元前：-400-01-01 同样是星期六，跨越 0 年
+	walk(-400, 6, 150000);
+
+	// 可以表示的年份的两端
+	const Date lo(cxx::min_year, Month::jan, 1);
+	const Date hi(cxx::max_year, Month::dec, 31);
+
+	check(Date(lo.days()) == lo && Date(hi.days()) == hi, "round trip");
+	check(lo < hi && lo.days() < 0 && 0 < hi.days(), "range");
+	for(int i = 0; i != 800; ++i)
+	{
+		const Date a(lo.days() + i), b(hi.days() - i);
+
+		check(a.days() == lo.days() + i && b.days() == hi.days() - i
+				&& Date(a.year(), a.month(), a.day()) == a
+				&& Date(b.year(), b.month(), b.day()) == b,
+			"extreme " + to_string(a) + ' ' + to_string(b));
+	}
+	check(!cxx::is_date(cxx::min_year - 1, Month::dec, 31)
+			&& !cxx::is_date(cxx::max_year + 1, Month::jan, 1),
+		"out of range");
+	try
+	{
+		Date(cxx::max_year + 1, Month::jan, 1);
+		check(false, "no exception");
+	}
+	catch(Date::Invalid&)
+	{}
+
+	Date d(cxx::max_year, Month::jan, 31);
+
+	d.add_month(1);
+	cout << lo << ' ' << hi << ' ' << d << ' ' << cxx::day_of_week(lo) << ' '
+		 << cxx::day_of_week(hi) << endl;
+	d = Date(0, Month::jan, 1);
+	d.add_month(-1);
+	cout << d << ' ' << cxx::next_Sunday(Date()) << ' '
+		 << cxx::next_weekday(Date(2024, Month::may, 3)) << endl;
+}
+
+} // namespace chrono_test
+
+namespace date_io_test
+{
+
+using cxx::Date;
+using cxx::date_error;
+using cxx::date_format;
+using cxx::Month;
+using cxx::vector;
+
+string
+errors_string(const vector<date_error>& errors)
+{
+	string s;
+
+	for(const auto e : errors)
+		s += char('0' + static_cast<int>(e));
+	return s;
+}
+
+void
+round_trip(const vector<Date>& ds, date_format fmt)
+{
+	string buf(ds.size() * (cxx::max_date_chars + 1), '\0');
+
+	buf.resize(cxx::format_dates(ds.data(), ds.data() + ds.size(), fmt, &buf[0]));
+
+	vector<Date> back;
+	vector<date_error> errors;
+	const auto n = cxx::parse_dates(buf, fmt, back, errors);
+	bool ok = n == 0 && back.size() == ds.size();
+
+	for(std::size_t i = 0; ok && i != ds.size(); ++i)
+		ok = back[i] == ds[i] && errors[i] == date_error::ok;
+	check(ok, "round trip " + std::to_string(static_cast<int>(fmt)));
+}
+
+void
+test()
+{
+	cout << "date io test:\n";
+
+	std::mt19937 rng(5);
+	const int span = cxx::max_year * 365;
+	vector<Date> ds{Date(cxx::min_year, Month::jan, 1),
+		Date(cxx::max_year, Month::dec, 31), Date(0, Month::jan, 1),
+		Date(-1, Month::dec, 31), Date(9999, Month::dec, 31),
+		Date(10000, Month::jan, 1), Date(-999, Month::jan, 1),
+		Date(-1000, Month::jan, 1)};
+
+	for(int i = 0; i != 20000; ++i)
+		ds.push_back(Date(int(rng() % 200000) - 100000));
+	for(int i = 0; i != 20000; ++i)
+		ds.push_back(Date(int(rng() % unsigned(span)) - span / 2));
+	round_trip(ds, date_format::iso);
+	round_trip(ds, date_format::tuple);
+
+	Date samples[]{Date(2024, Month::feb, 29), Date(-5, Month::dec, 3),
+		Date(12345, Month::jun, 7), Date(7, Month::jul, 4)};
+	char buf[4 * (cxx::max_date_chars + 1)];
+
+	cout << string(buf, cxx::format_dates(samples, samples + 4,
+		date_format::iso, buf, ' ')) << endl;
+	cout << string(buf, cxx::format_dates(samples, samples + 4,
+		date_format::tuple, buf, ' ')) << endl;
+
+	// 每个字节都可能使 64 位字中的检查失败
+	const char iso[] = "2024-02-29\n2023-02-29\n2024-13-01\n2024-1-01\n"
+		"  2024-01-05\r\n+12345-06-07\n-0001-12-31\n--001-12-31\n+123-01-01\n"
+		"2024-01-0x\n\n2024/01/01\n+99999999999-01-01\n2024-0/-01\n"
+		"2024-0:-01\n20a4-01-01\n+4194304-01-01\n-4194304-01-01\n2024-01-31";
+	vector<Date> d;
+	vector<date_error> e;
+	auto n = cxx::parse_dates(iso, date_format::iso, d, e);
+
+	check(n == 13 && errors_string(e) == "0221000111112111200"
+			&& d[4] == Date(2024, Month::jan, 5) && d[1] == Date()
+			&& d[17] == Date(cxx::min_year, Month::jan, 1)
+			&& d.back() == Date(2024, Month::jan, 31),
+		"iso errors " + errors_string(e));
+
+	const char tuple[] = "(2024,2,29);(2023,2,29);(1,2,3,);(1,2);( 1,2,3);"
+		"(-5,1,1);(1,2,3)x;(1,2,3;(1,13,1);(1,1,99999999999)";
+
+	d.clear();
+	e.clear();
+	n = cxx::parse_dates(tuple, date_format::tuple, d, e, ';');
+	check(n == 8 && errors_string(e) == "0211101122"
+			&& d[5] == Date(-5, Month::jan, 1),
+		"tuple errors " + errors_string(e));
+
+	std::istringstream is("(-5,12,3) (2001;2;3) (2001,2,29)");
+	Date x, y;
+
+	is >> x;
+	check(is && x == Date(-5, Month::dec, 3), "operator>>");
+	is >> y;
+	check(!is && y == Date(), "operator>> syntax");
+	is.clear();
+	try
+	{
+		is >> y;
+		check(false, "operator>> invalid");
+	}
+	catch(Date::Invalid&)
+	{}
+}
+
+} // namespace date_io_test
+
+namespace date_column_test
+{
+
+using cxx::Date;
+using cxx::date_column;
+using cxx::Day;
+using cxx::Month;
+
+// 位图和逐行比较的结果相同，最后一个字中超出的位为 0
+void
+check_filter(const date_column& col, Date lo, Date hi)
+{
+	const auto n = col.size();
+	const auto bitmap = col.between(lo, hi);
+	std::size_t count = 0;
+	bool ok = bitmap.size() == cxx::bitmap_words(n);
+
+	for(std::size_t i = 0; ok && i != n; ++i)
+	{
+		const bool in = !(col[i] < lo) && !(hi < col[i]);
+
+		count += in;
+		ok = ((bitmap[i / 64] >> i % 64) & 1) == in;
+	}
+	if(ok && n % 64 != 0)
+		ok = bitmap.back() >> n % 64 == 0;
+
+	cxx::vector<uint64_t> words(cxx::bitmap_words(n), ~uint64_t());
+
+	check(ok && col.filter_between(lo, hi, words.data()) == count
+			&& words == bitmap,
+		"filter " + std::to_string(n) + ' ' + to_string(lo) + ' '
+			+ to_string(hi));
+}
+
+// 字段、分组键和分组与逐个 Date 计算的结果相同
+void
+check_groups(const date_column& col)
+{
+	const auto n = col.size();
+	cxx::vector<int32_t> y(n), m(n), d(n), w(n), mk(n), wk(n);
+
+	col.years(y.data());
+	col.months(m.data());
+	col.days_of_month(d.data());
+	col.weekdays(w.data());
+	col.month_keys(mk.data());
+	col.week_keys(wk.data());
+
+	std::map<int, std::size_t> by_month, by_week;
+	bool ok = true;
+
+	for(std::size_t i = 0; i != n; ++i)
+	{
+		const Date r = col[i];
+		const int z = r.days();
+		// the Monday on or before r
+		const int monday = z - (static_cast<int>(cxx::day_of_week(r)) + 6) % 7;
+
+		ok = ok && y[i] == r.year() && m[i] == static_cast<int>(r.month())
+			&& d[i] == r.day() && w[i] == static_cast<int>(cxx::day_of_week(r))
+			&& mk[i] == (r.year() - 1970) * 12 + m[i] - 1
+			// 1969-12-29 is day -3
+			&& wk[i] == (monday + 3) / 7;
+		++by_month[(r.year() - 1970) * 12 + m[i] - 1];
+		++by_week[monday];
+	}
+	check(ok, "fields " + std::to_string(n));
+
+	const auto gm = col.group_by_month();
+	const auto gw = col.group_by_week();
+
+	ok = gm.size() == by_month.size() && gw.size() == by_week.size();
+	if(ok)
+	{
+		std::size_t k = 0;
+
+		for(const auto& g : by_month)
+		{
+			const Date f = gm[k].first;
+
+			ok = ok && f.day() == 1
+				&& (f.year() - 1970) * 12 + static_cast<int>(f.month()) - 1
+					== g.first
+				&& gm[k].count == g.second;
+			++k;
+		}
+		k = 0;
+		for(const auto& g : by_week)
+		{
+			ok = ok && gw[k].first.days() == g.first
+				&& cxx::day_of_week(gw[k].first) == Day::monday
+				&& gw[k].count == g.second;
+			++k;
+		}
+	}
+	check(ok, "groups " + std::to_string(n));
+}
+
+void
+test()
+{
+	cout << "date column test:\n";
+
+	std::mt19937 rng(9);
+	// 行数不是 64 的倍数时检查最后一个字
+	const std::size_t sizes[]{0, 1, 7, 63, 64, 65, 127, 200, 1000, 4097};
+
+	for(int round = 0; round != 30; ++round)
+	{
+		const auto n = sizes[round % 10];
+		// 稠密：约 10 年；稀疏：几乎整个可以表示的范围
+		const bool sparse = round % 3 == 0;
+		date_column col;
+
+		col.reserve(n);
+		for(std::size_t i = 0; i != n; ++i)
+			col.push_back(Date(sparse
+					? int(int64_t(rng() % 3060000000U) - 1530000000)
+					: int(rng() % 4000) + 18000));
+		if(round == 1)
+		{
+			col.push_back(Date(cxx::min_year, Month::feb, 1));
+			col.push_back(Date(cxx::max_year, Month::dec, 31));
+		}
+		check_groups(col);
+		for(int q = 0; q != 20; ++q)
+		{
+			Date lo = col.empty() ? Date() : col[rng() % col.size()];
+			Date hi = col.empty() ? Date() : col[rng() % col.size()];
+
+			if(q % 5 == 0)
+				hi = lo;
+			check_filter(col, lo, hi);
+		}
+		check_filter(col, Date(cxx::min_year, Month::jan, 1),
+			Date(cxx::max_year, Month::dec, 31));
+	}
+
+	const Date dates[]{Date(2024, Month::jan, 31), Date(2024, Month::feb, 1),
+		Date(2024, Month::feb, 29), Date(2024, Month::mar, 3),
+		Date(2024, Month::mar, 4), Date(2023, Month::dec, 31)};
+	const date_column col(dates, dates + 6);
+
+	for(const auto& g : col.group_by_month())
+		cout << g.first << ':' << g.count << ' ';
+	cout << endl;
+	for(const auto& g : col.group_by_week())
+		cout << g.first << ':' << g.count << ' ';
+	cout << endl;
+	cout << col.between(Date(2024, Month::feb, 1), Date(2024, Month::mar, 3))[0]
+		 << endl;
+}
+
+} // namespace date_column_test
+
+} // unnamed namespace
+
+int
+main()
+{
+	chrono_test::test();
+	date_io_test::test();
+	date_column_test::test();
+	cout << "failures: " << failures << endl;
+	return failures == 0 ? 0 : 1;
+}
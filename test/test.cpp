@@ -1,6 +1,14 @@
 #include "cxx/vector.hpp"
 #include "cxx/array.hpp"
+#include "cxx/allocator.hpp"
+#include "cxx/flat_map.hpp"
+#include "cxx/hash_map.hpp"
+#include "cxx/container_stats.hpp"
+#include "cxx/parallel.hpp"
+#include "cxx/thread_pool.hpp"
 #include <iostream>
+#include <iterator>
+#include <sstream>
 #include <string>
 #include <span>
 #include <deque>
@@ -135,6 +143,15 @@ test()
 	vector<int> v10(v9.begin(), v9.begin() + 5);
 	println(v10);
 
+	// single-pass ranges must not be traversed to size the storage
+	std::istringstream in("1 2 3 4");
+	vector<int> v11{std::istream_iterator<int>(in), std::istream_iterator<int>()};
+	println(v11);
+	in.clear();
+	in.str("5 6 7");
+	v11.assign(std::istream_iterator<int>(in), std::istream_iterator<int>());
+	println(v11);
+
 	// cout << (v10 == v9) << ' ' << (v10 != v9) << '\n';
 	// cout << (v10 < v9) << '\n';
 	// cout << (v10 >= v9) << ' ' << (v10 <= v9) << '\n';
@@ -149,6 +166,248 @@ test()
 
 } // namespace vector_test
 
+namespace small_vector_test
+{
+
+using cxx::small_vector;
+using std::string;
+using vector_test::println;
+
+void
+test()
+{
+	cout << "small_vector test:\n";
+	small_vector<int, 4> v{1, 2, 3};
+	println(v);
+	v.push_back(4);
+	println(v);
+	v.push_back(5);
+	println(v);
+
+	small_vector<int, 4> v2{6, 7};
+	v2.swap(v);
+	println(v);
+	println(v2);
+
+	small_vector<string, 2> v3{"一", "二"};
+	auto v4(std::move(v3));
+	println(v3);
+	println(v4);
+	v4.emplace_back("三");
+	v3 = std::move(v4);
+	println(v3);
+}
+
+} // namespace small_vector_test
+
+namespace allocator_test
+{
+
+using cxx::vector;
+using std::string;
+using vector_test::println;
+
+void
+test()
+{
+	cout << "allocator test:\n";
+	cxx::monotonic_arena arena;
+	vector<string, cxx::arena_allocator<string>> v(arena);
+
+	v.assign({"a", "b", "c"});
+	println(v);
+
+	vector<string, cxx::arena_allocator<string>> v2(std::move(v), arena);
+	println(v2);
+
+	cxx::pool_resource pool(sizeof(int) * 8);
+	vector<int, cxx::pool_allocator<int>> v3(pool);
+
+	for(int i = 0; i < 10; ++i)
+		v3.push_back(i);
+	println(v3);
+
+	// over-aligned elements bypass the blocks but keep their alignment
+	struct alignas(64) line
+	{
+		int value;
+	};
+	vector<line, cxx::pool_allocator<line>> v4(pool);
+	bool aligned(true);
+
+	for(int i = 0; i < 10; ++i)
+	{
+		v4.push_back({i});
+		aligned = aligned
+			&& reinterpret_cast<std::uintptr_t>(v4.data()) % alignof(line) == 0;
+	}
+	cout << aligned << ' ' << v4.back().value << endl;
+}
+
+} // namespace allocator_test
+
+namespace flat_map_test
+{
+
+using std::string;
+
+// 复制时可以抛出异常的值
+struct fragile
+{
+	bool fail = false;
+
+	fragile() = default;
+	explicit fragile(bool f) : fail(f)
+	{}
+	fragile(const fragile& x) : fail(x.fail)
+	{
+		if(fail)
+			throw std::runtime_error("copy");
+	}
+	fragile(fragile&&) = default;
+
+	fragile&
+	operator=(const fragile&) = default;
+	fragile&
+	operator=(fragile&&) = default;
+};
+
+// 比较 13 时抛出异常
+struct fussy_less
+{
+	bool
+	operator()(int x, int y) const
+	{
+		if(x == 13 || y == 13)
+			throw std::runtime_error("compare");
+		return x < y;
+	}
+};
+
+template<typename _tSet>
+void
+println(const _tSet& s)
+{
+	cout << "result: { ";
+	for(const auto& i : s)
+		cout << i << ' ';
+	cout << "}" << endl;
+}
+
+void
+test()
+{
+	cout << "flat_map test:\n";
+	cxx::flat_set<int> s{5, 3, 9, 1, 3};
+	println(s);
+	s.insert({4, 8, 1});
+	println(s);
+	cout << s.contains(4) << ' ' << *s.lower_bound(6) << endl;
+
+	cxx::flat_map<string, int, std::less<>> m{{"b", 2}, {"a", 1}};
+	m["c"] = 3;
+	m.insert({{"d", 4}, {"a", 0}});
+	for(const auto& p : m)
+		cout << p.first << ':' << p.second << ' ';
+	cout << '\n' << m.at("d") << ' ' << m.count("e") << endl;
+
+	// a failed bulk insertion leaves the old elements sorted and usable
+	cxx::flat_map<int, fragile> fm{{1, fragile()}, {5, fragile()}};
+	std::pair<int, fragile> extra[]{{3, fragile()}, {7, fragile(true)}};
+
+	try
+	{
+		fm.insert(std::begin(extra), std::end(extra));
+	}
+	catch(std::exception& e)
+	{
+		cout << "caught " << e.what() << endl;
+	}
+	cout << fm.size() << ' ' << (fm.find(5) != fm.end()) << endl;
+
+	cxx::flat_map<int, int, fussy_less> fc{{1, 1}, {5, 5}};
+	cxx::flat_set<int, fussy_less> sc{1, 5, 9};
+
+	try
+	{
+		fc.insert({{3, 3}, {13, 13}});
+	}
+	catch(std::exception& e)
+	{
+		cout << "caught " << e.what() << endl;
+	}
+	try
+	{
+		sc.insert({7, 13, 2});
+	}
+	catch(std::exception& e)
+	{
+		cout << "caught " << e.what() << endl;
+	}
+	for(const auto& p : fc)
+		cout << p.first << ':' << p.second << ' ';
+	cout << '\n' << fc.count(5) << ' ' << sc.count(9) << endl;
+	println(sc);
+}
+
+} // namespace flat_map_test
+
+namespace hash_map_test
+{
+
+using std::string;
+
+// 透明的散列函数，以 const char* 查找时不构造 string
+struct string_hash
+{
+	using is_transparent = void;
+
+	size_t
+	operator()(const char* s) const noexcept
+	{
+		size_t h(14695981039346656037ULL);
+
+		for(; *s != '\0'; ++s)
+			h = (h ^ static_cast<unsigned char>(*s)) * 1099511628211ULL;
+		return h;
+	}
+	size_t
+	operator()(const string& s) const noexcept
+	{
+		return (*this)(s.c_str());
+	}
+};
+
+void
+test()
+{
+	cout << "hash_map test:\n";
+	cxx::hash_map<string, int> m{{"one", 1}, {"two", 2}};
+	for(int i = 0; i < 100; ++i)
+		m[std::to_string(i)] = i;
+	m.erase("one");
+	cout << m.size() << ' ' << m.count("one") << ' ' << m.at("two") << ' '
+		 << m.find("42")->second << endl;
+	cout << m.try_emplace("two", 0).second << ' '
+		 << m.insert_or_assign("two", 22).first->second << endl;
+
+	int sum = 0;
+	for(const auto& p : m)
+		sum += p.second;
+	cout << sum << ' ' << (m.load_factor() <= 0.875F) << endl;
+
+	m.erase(m.find("42"));
+	m.erase(m.cbegin());
+	cout << m.size() << ' ' << m.contains("42") << endl;
+
+	cxx::hash_map<string, int, string_hash, std::equal_to<>> t{{"key", 7}};
+
+	cout << t.count("key") << ' ' << t.at("key") << ' ' << t.erase("key")
+		 << ' ' << t.size() << endl;
+}
+
+} // namespace hash_map_test
+
 namespace array_test
 {
 
@@ -217,6 +476,218 @@ test()
 
 } // namespace array_test
 
+namespace stats_test
+{
+
+using cxx::vector;
+using std::string;
+using vector_test::println;
+
+void
+print(const char* name, const cxx::stats_snapshot& s)
+{
+	cout << name << ": allocations " << s.allocations << " deallocations "
+		 << s.deallocations << " reserve calls " << s.reserve_calls
+		 << " growths " << s.growths << " moved " << s.elements_moved
+		 << " peak capacity " << s.peak_capacity << " releases "
+		 << s.releases << " slack " << s.slack_elements << endl;
+}
+
+void
+test()
+{
+	cout << "stats test:\n";
+	cxx::container_stats grown, reserved;
+
+	{
+		vector<int, cxx::instrumented_allocator<int>> v{
+			cxx::instrumented_allocator<int>(grown)};
+
+		for(int i = 0; i < 100; ++i)
+			v.push_back(i);
+		v.insert(v.begin() + 50, 7);
+		v.erase(v.begin());
+	}
+	print("grown", grown.snapshot());
+	{
+		vector<string, cxx::instrumented_allocator<string>> v{
+			cxx::instrumented_allocator<string>(reserved)};
+
+		v.reserve(100);
+		v.reserve(10);
+		for(int i = 0; i < 100; ++i)
+			v.emplace_back(1, char('a' + i % 26));
+		println(vector<string>(v.begin(), v.begin() + 8));
+	}
+	print("reserved", reserved.snapshot());
+
+	auto& site(CXX_STATS_SITE);
+	vector<int, cxx::instrumented_allocator<int>> a{
+		cxx::instrumented_allocator<int>(site)},
+		b;
+
+	a.assign({1, 2, 3});
+	b = std::move(a);
+	b.swap(a);
+	print("site", site.snapshot());
+	cout << (&CXX_STATS_SITE != &site) << endl;
+}
+
+} // namespace stats_test
+
+namespace parallel_test
+{
+
+using cxx::vector;
+using std::string;
+using vector_test::println;
+namespace parallel = cxx::parallel;
+
+void
+test()
+{
+	cout << "parallel test:\n";
+	parallel::options opts;
+
+	opts.threads = 4;
+	opts.grain = 16;
+
+	vector<int> v(1000);
+	unsigned x(1);
+
+	for(auto& i : v)
+		i = int((x = x * 1103515245U + 12345U) >> 16) % 1000;
+
+	parallel::sort(opts, v.begin(), v.end());
+	cout << std::is_sorted(v.begin(), v.end()) << ' ' << v.front() << ' '
+		 << v.back() << endl;
+	parallel::sort(opts, v.begin(), v.end(), std::greater<>());
+	cout << std::is_sorted(v.begin(), v.end(), std::greater<>()) << endl;
+	cout << parallel::reduce(opts, v.begin(), v.end()) << ' '
+		 << parallel::transform_reduce(opts, v.begin(), v.end(), 0L,
+				std::plus<>(), [](int i) { return long(i) * i; })
+		 << endl;
+
+	vector<int> sums(v.size());
+
+	parallel::inclusive_scan(opts, v.begin(), v.end(), sums.begin());
+	cout << sums.back() << endl;
+
+	cxx::array<double, 100> a;
+
+	parallel::transform(opts, v.begin(), v.begin() + 100, a.begin(),
+		[](int i) { return i / 8.0; });
+	opts.deterministic = true;
+	cout << parallel::reduce(opts, a.begin(), a.end(), 0.0) << endl;
+
+	vector<string> words{"pear", "fig", "apple", "kiwi", "plum", "date"};
+
+	opts.grain = 1;
+	parallel::sort(opts, words.begin(), words.end());
+	println(words);
+}
+
+} // namespace parallel_test
+
+namespace thread_pool_test
+{
+
+using cxx::thread_pool;
+using cxx::vector;
+
+long
+fib(thread_pool& pool, int n)
+{
+	if(n < 12)
+		return n < 2 ? n : fib(pool, n - 1) + fib(pool, n - 2);
+
+	long x(0), y(0);
+
+	pool.parallel_invoke(
+		[&] { x = fib(pool, n - 1); }, [&] { y = fib(pool, n - 2); });
+	return x + y;
+}
+
+void
+test()
+{
+	cout << "thread_pool test:\n";
+	{
+		thread_pool pool(3);
+
+		cout << pool.size() << ' ' << pool.is_worker() << ' ' << fib(pool, 25)
+			 << endl;
+
+		vector<std::future<int>> futures;
+
+		for(int i(0); i != 10000; ++i)
+			futures.push_back(pool.submit([i] { return i % 7; }));
+
+		long total(0);
+
+		for(auto& f : futures)
+			total += f.get();
+		cout << total << ' '
+			 << pool.submit([&] { return pool.is_worker(); }).get() << endl;
+
+		// nested loops and waiting inside tasks help instead of blocking
+		std::atomic<long> sum{0};
+
+		pool.run_chunks(16, 4, [&](size_t i, unsigned) {
+			auto inner(pool.submit([i] { return long(i); }));
+
+			pool.run_chunks(64, 4, [&](size_t j, unsigned) {
+				sum.fetch_add(long(i * 64 + j), std::memory_order_relaxed);
+			});
+			pool.wait(inner);
+			sum.fetch_add(inner.get(), std::memory_order_relaxed);
+		});
+		cout << sum.load() << endl;
+
+		try
+		{
+			pool.parallel_invoke([] {}, [] { throw std::runtime_error("a"); },
+				[] {});
+		}
+		catch(std::exception& e)
+		{
+			cout << "caught " << e.what() << endl;
+		}
+		try
+		{
+			pool.submit([]() -> int { throw std::runtime_error("b"); }).get();
+		}
+		catch(std::exception& e)
+		{
+			cout << "caught " << e.what() << endl;
+		}
+		try
+		{
+			pool.run_chunks(100, 4, [](size_t i, unsigned) {
+				if(i == 42)
+					throw std::runtime_error("c");
+			});
+		}
+		catch(std::exception& e)
+		{
+			cout << "caught " << e.what() << endl;
+		}
+	}
+
+	// the destructor runs the tasks still queued
+	std::atomic<int> ran{0};
+
+	{
+		thread_pool pool(2);
+
+		for(int i(0); i != 1000; ++i)
+			pool.submit([&] { ran.fetch_add(1, std::memory_order_relaxed); });
+	}
+	cout << ran.load() << endl;
+}
+
+} // namespace thread_pool_test
+
 } // unnamed namespace
 
 int
@@ -226,5 +697,12 @@ main()
 	using std::deque;
 
 	vector_test::test();
+	small_vector_test::test();
+	allocator_test::test();
+	flat_map_test::test();
+	hash_map_test::test();
 	array_test::test();
+	stats_test::test();
+	parallel_test::test();
+	thread_pool_test::test();
 }
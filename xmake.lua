@@ -24,17 +24,66 @@ add_requires("pacman::fmt", {system = true, alias = "fmt"})
 add_packages("boost")
 add_packages("fmt")
 
--- target("base")
--- 	set_kind("static")
--- 	add_files("src/Chrono.cpp")
+target("base")
+	set_kind("static")
+	set_languages("c++17")
+	add_includedirs("src", {public = true})
+	add_files("src/Chrono.cpp", "src/DateColumn.cpp")
 
 target("test")
     set_kind("binary")
 	add_files("test/test.cpp")
+	if is_plat("linux") then
+		add_syslinks("pthread")
+	end
     -- add_files("src/calculator.cpp")
 	-- add_files("test/manipulator.cpp")
 	-- add_deps("base")
 
+-- the calculator sources need C++17 (string_view, [[fallthrough]])
+target("calculator_core")
+	set_kind("static")
+	set_languages("c++17")
+	add_includedirs("src", {public = true})
+	add_files("src/Lexical.cpp", "src/Program.cpp", "src/Optimizer.cpp",
+		"src/Batch.cpp", "src/Driver.cpp", "src/Jit.cpp")
+	if is_plat("linux") then
+		add_syslinks("pthread", {public = true})
+	end
+
+target("calculator")
+	set_kind("binary")
+	set_languages("c++17")
+	add_files("src/calculator.cpp")
+	add_deps("calculator_core")
+
+-- xmake run calculator_test: JitProgram against the interpreter
+target("calculator_test")
+	set_kind("binary")
+	set_languages("c++17")
+	add_files("test/calculator_test.cpp")
+	add_deps("calculator_core")
+
+-- xmake run chrono_test: Date, parse_dates/format_dates and date_column
+target("chrono_test")
+	set_kind("binary")
+	set_languages("c++17")
+	add_files("test/chrono_test.cpp")
+	add_deps("base")
+
+-- xmake f -m release && xmake run bench [--max-size=N] [--filter=...]
+target("bench")
+    set_kind("binary")
+	add_files("bench/bench.cpp")
+
+-- xmake f -m release && xmake run bench_thread_pool [--max-threads=N] [--pin=1]
+target("bench_thread_pool")
+    set_kind("binary")
+	add_files("bench/thread_pool.cpp")
+	if is_plat("linux") then
+		add_syslinks("pthread")
+	end
+
 --
 -- If you want to known more usage about xmake, please see https://xmake.io
 --